@@ -267,7 +267,7 @@ constructCompileCommand(Builder builder, Step step) {
 	}
 
 	switch (builder.mode) {
-	case BuildMode_Debug: dcsPush(&cmdBuilder, 1, "/Zi "); break;
+	case BuildMode_Debug: dcsPush(&cmdBuilder, 1, "/Zi /DWIREDECK_DEBUG "); break;
 	}
 
 	// NOTE(khvorov) obj output
@@ -411,6 +411,7 @@ main() {
 		"code/SDL/src/timer/*.c",
 		"code/SDL/src/video/*.c",
 		"code/SDL/src/video/yuv2rgb/*.c",
+		"code/SDL/src/video/dummy/*.c",
 		"code/SDL/src/render/*.c",
 		"code/SDL/src/render/software/*.c",
 		"code/SDL/src/cpuinfo/*.c",
@@ -570,5 +571,22 @@ main() {
 
 	execStep(builder, wiredeckStep);
 
+	cstring wiredeckBenchSources[] = {"code/wiredeck_bench.c"};
+
+	Step wiredeckBenchStep = {
+		.name = "wiredeck_bench",
+		.kind = BuildKind_Exe,
+		.sources = wiredeckBenchSources,
+		.sourcesLen = arrLen(wiredeckBenchSources),
+		.flags = wiredeckFlags,
+		.flagsLen = arrLen(wiredeckFlags),
+		.link = wiredeckLink,
+		.linkLen = arrLen(wiredeckLink),
+		.extraWatch = wiredeckExtraWatch,
+		.extraWatchLen = arrLen(wiredeckExtraWatch),
+	};
+
+	execStep(builder, wiredeckBenchStep);
+
 	return 0;
 }
@@ -1,14 +1,47 @@
 #include <stdint.h>
 #include "SDL.h"
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SCAN_X86 1
+#include <immintrin.h>
+#else
+#define SCAN_X86 0
+#endif
+
+// NOTE(khvorov) gcc and clang only allow vector intrinsics in functions
+// compiled for that instruction set, msvc allows them anywhere
+#ifdef __GNUC__
+#define SCAN_TARGET_SSE2 __attribute__((target("sse2")))
+#define SCAN_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SCAN_TARGET_SSE2
+#define SCAN_TARGET_AVX2
+#endif
 
 #define true 1
 #define false 0
 #define function static
 
 typedef uint8_t u8;
+typedef uint32_t u32;
+typedef uint64_t u64;
 typedef int32_t b32;
 typedef int32_t i32;
+typedef int64_t i64;
 typedef float f32;
+typedef double f64;
 
 typedef struct InputKey {
 	i32 halfTransitionCount;
@@ -17,15 +50,37 @@ typedef struct InputKey {
 
 typedef enum InputKeyID {
 	InputKeyID_MouseLeft,
+	InputKeyID_F1,
+	InputKeyID_F2,
+	InputKeyID_F3,
+	InputKeyID_Enter,
+	InputKeyID_Backspace,
+	InputKeyID_Escape,
 	InputKeyID_Count,
 } InputKeyID;
 
+#define INPUT_TEXT_CAP 16
+
 typedef struct Input {
 	InputKey keys[InputKeyID_Count];
 	i32 cursorX;
 	i32 cursorY;
+	f32 scrollY; // NOTE(khvorov) Wheel notches this frame, positive is away from the user
+	char text[INPUT_TEXT_CAP]; // NOTE(khvorov) Ascii typed this frame
+	i32 textLen;
+	u32 cursorWindowID; // NOTE(khvorov) SDL id of the os window that last reported the cursor
+	u64 eventTime; // NOTE(khvorov) Performance counter time of the oldest event this frame, 0 without any
 } Input;
 
+typedef struct Arena {
+	char* name;
+	u8* base;
+	size_t reserved;
+	size_t committed;
+	size_t used;
+	size_t highWater;
+} Arena;
+
 typedef enum Direction {
 	Direction_Top,
 	Direction_Right,
@@ -34,60 +89,674 @@ typedef enum Direction {
 	Direction_Count,
 } Direction;
 
-typedef enum UIWindowID {
-	UIWindowID_Root = -1,
-	UIWindowID_1,
-	UIWindowID_2,
-	UIWindowID_Count,
-} UIWindowID;
+// NOTE(khvorov) Index into the window arrays. Gets reused after the window is
+// destroyed so anything that outlives a frame should hold a UIWindowHandle.
+typedef i32 UIWindowID;
+#define UIWindowID_Root -1
+#define UIWindowID_Invalid -2
+
+typedef struct UIWindowHandle {
+	UIWindowID id;
+	i32 generation;
+} UIWindowHandle;
+
+typedef enum ProfileZoneKind {
+	ProfileZoneKind_Events,
+	ProfileZoneKind_PaceWait,
+	ProfileZoneKind_Update,
+	ProfileZoneKind_Draw,
+	ProfileZoneKind_Render,
+	ProfileZoneKind_Present,
+	ProfileZoneKind_InputToPresent, // NOTE(khvorov) From the oldest event in a frame to its present, spans frames
+	ProfileZoneKind_Count,
+} ProfileZoneKind;
+
+typedef struct ProfileZone {
+	ProfileZoneKind kind;
+	u64 start;
+} ProfileZone;
+
+// NOTE(khvorov) sequence is the event's index + 1 once the event is fully
+// written, so a reader can tell a finished slot from one that is being
+// overwritten by a writer on another thread
+typedef struct ProfileEvent {
+	SDL_atomic_t sequence;
+	ProfileZoneKind kind;
+	SDL_threadID threadID;
+	u64 start;
+	u64 end;
+} ProfileEvent;
+
+typedef enum ProfileCounterKind {
+	ProfileCounterKind_PixelsTouched,
+	ProfileCounterKind_Overdraw,
+	ProfileCounterKind_OverdrawUnculled,
+	ProfileCounterKind_DrawCmds,
+	ProfileCounterKind_DrawBatches, // NOTE(khvorov) Draw commands once merged
+	ProfileCounterKind_WindowsRendered,
+	ProfileCounterKind_WindowsCulled,
+	ProfileCounterKind_FramesSkipped, // NOTE(khvorov) Published but built again before they were drawn, for the session
+	ProfileCounterKind_Count,
+} ProfileCounterKind;
+
+typedef enum PresentMode {
+	PresentMode_Immediate,
+	PresentMode_Capped,
+	PresentMode_Spaced,
+	PresentMode_Count,
+} PresentMode;
+
+typedef enum PresentReason {
+	PresentReason_Startup,
+	PresentReason_Idle,
+	PresentReason_Dragging,
+	PresentReason_DraggingSlowFrames,
+	PresentReason_Animating,
+	PresentReason_AnimatingPresentBlocks,
+	PresentReason_Count,
+} PresentReason;
+
+typedef struct ProfileFrame {
+	u64 zoneTicks[ProfileZoneKind_Count];
+	u64 inputToPresentTicks; // NOTE(khvorov) The slowest of the frames presented during this one
+	f32 counters[ProfileCounterKind_Count];
+} ProfileFrame;
+
+#define PROFILE_EVENTS_CAP (1 << 16)
+#define PROFILE_FRAMES_CAP 256
+#define PROFILE_LATENCY_BUCKETS 64 // NOTE(khvorov) A millisecond each, the last one takes everything slower
+
+// NOTE(khvorov) Any thread can end a zone. Writers claim a slot with an
+// atomic increment and never wait. Frame totals are only touched by the
+// thread that calls profileEndFrame.
+typedef struct Profiler {
+	SDL_atomic_t eventsWritten;
+	ProfileEvent events[PROFILE_EVENTS_CAP];
+
+	u32 eventsCollected;
+	u32 framesEnded;
+	ProfileFrame frames[PROFILE_FRAMES_CAP];
+
+	// NOTE(khvorov) Set by the ui thread, they carry over into every frame
+	// until they are set again
+	f32 counters[ProfileCounterKind_Count];
+
+	// NOTE(khvorov) Input to present latency of every presented frame that had
+	// input in it, for the whole session. Any render thread adds to it.
+	SDL_atomic_t inputToPresentCounts[PROFILE_LATENCY_BUCKETS];
+
+	// NOTE(khvorov) Set by the ui thread whenever the present policy switches
+	PresentMode presentMode;
+	PresentReason presentReason;
+	u32 presentSwitchFrame;
+} Profiler;
+
+#define DAMAGE_RECTS_MAX 16
+
+// NOTE(khvorov) Screen areas that need to be redrawn this frame. Rects are
+// kept disjoint so that their areas add up to the number of touched pixels.
+typedef struct Damage {
+	SDL_Rect rects[DAMAGE_RECTS_MAX];
+	i32 count;
+} Damage;
+
+#define REGION_RECTS_MAX 64
+
+// NOTE(khvorov) Disjoint rects
+typedef struct Region {
+	SDL_Rect rects[REGION_RECTS_MAX];
+	i32 count;
+} Region;
+
+typedef struct FrameStats {
+	i32 pixelsTouched;
+	i32 drawCmdCount;
+	i32 drawBatchCount;
+	i32 windowsRendered;
+	i32 windowsCulled;
+	i32 pixelsDrawn;
+	i32 pixelsDrawnUnculled; // NOTE(khvorov) What painting every damaged window whole would have cost
+} FrameStats;
+
+typedef enum DrawCmdKind {
+	DrawCmdKind_Rect,
+	DrawCmdKind_Glyph, // NOTE(khvorov) Quad out of the glyph atlas tinted by color
+	DrawCmdKind_Image, // NOTE(khvorov) Straight copy out of a window's cache
+} DrawCmdKind;
+
+// NOTE(khvorov) No textures in here, the ui thread doesn't have any. Whoever
+// draws the list knows the glyph atlas and the window caches.
+typedef struct DrawCmd {
+	DrawCmdKind kind;
+	SDL_Rect rect;
+	SDL_Color color;
+	SDL_Rect texRect;
+	UIWindowID window; // NOTE(khvorov) Images come out of this window's cache
+} DrawCmd;
+
+typedef struct DrawBatch {
+	DrawCmdKind kind;
+	SDL_Color color;
+	SDL_Rect bounds;
+	i32 firstRect;
+	i32 rectCount;
+} DrawBatch;
+
+#define DRAW_MERGE_LOOKBACK 64
+
+// NOTE(khvorov) Filled in draw order during the frame, out of the frame arena.
+// drawListMerge then groups commands into batches, only moving a command back
+// past batches it doesn't overlap, so the result looks the same. Rects batch
+// by color, glyphs batch by texture since their color goes into the vertices.
+typedef struct DrawList {
+	Arena* arena;
+	SDL_Point origin; // NOTE(khvorov) Subtracted from everything pushed, for drawing into textures
+	i32 cmdCap;
+	i32 cmdCount;
+	DrawCmd* cmds;
 
+	i32 batchCount;
+	DrawBatch* batches;
+	i32* cmdBatches;
+	SDL_Rect* batchRects;
+	i32* batchCmds;
+
+	SDL_Vertex* vertices;
+	i32* indices;
+} DrawList;
+
+// NOTE(khvorov) Pixels of one window as of the last time it was rendered.
+// Textures only ever grow so that resizing back and forth doesn't allocate.
+typedef struct WindowCache {
+	SDL_Texture* texture;
+	u32* pixels; // NOTE(khvorov) Instead of the texture when tiles are rasterized on the cpu
+	i32 texWidth;
+	i32 texHeight;
+} WindowCache;
+
+// NOTE(khvorov) What the render thread needs to bring one window's cache up to date
+typedef struct WindowJob {
+	UIWindowID window;
+	i32 width;
+	i32 height;
+	SDL_Rect dirty; // NOTE(khvorov) Window relative
+	DrawList list;
+} WindowJob;
+
+// NOTE(khvorov) Everything the render thread needs for one frame, built by the
+// ui thread out of the frame's own arena. Nobody writes to it once it's
+// published until the ui thread gets it back to build another frame in, apart
+// from the render thread leaving its timings for the present.
+typedef struct RenderFrame {
+	Arena arena;
+	u64 inputTime; // NOTE(khvorov) Oldest input whose effects are in the frame, 0 without any
+	u64 frameStart; // NOTE(khvorov) When the ui thread started building it
+	i32 width; // NOTE(khvorov) Of the os window, as the ui saw it
+	i32 height;
+	Damage damage;
+	i32 windowJobCount;
+	WindowJob* windowJobs;
+	DrawList composite;
+	u64 renderTicks;
+	u64 heldTicks; // NOTE(khvorov) Spent waiting for a present slot
+} RenderFrame;
+
+// NOTE(khvorov) 32 bit xrgb pixels, pitch is in pixels
+typedef struct RasterTarget {
+	u32* pixels;
+	i32 pitch;
+	i32 width;
+	i32 height;
+} RasterTarget;
+
+#define RENDER_FRAME_INDEX_MASK 3
+#define RENDER_FRAME_FRESH 4
+
+// NOTE(khvorov) Triple buffer between the ui and the render thread. The ui
+// thread builds into one frame, the render thread draws another and the
+// middle one is the latest finished frame. Either side trades its frame for
+// the middle one with a compare and swap, so neither ever waits for the
+// other. The fresh bit is set on the middle index until the frame is drawn.
+//
+// SDL frees and remakes the window surface from the event pump, so the render
+// thread never touches it. It draws into the canvas and hands the frame to
+// the ui thread, which copies the damaged parts into the window surface and
+// sends them to the screen. The render thread waits for that before it draws
+// into the canvas again.
+#define RENDER_CANVAS_DIM_MAX 8192
+
+typedef struct RenderQueue {
+	RenderFrame frames[3];
+	SDL_atomic_t middle;
+	i32 building; // NOTE(khvorov) Ui thread only
+	i32 drawing; // NOTE(khvorov) Render thread only
+	SDL_Thread* thread;
+	SDL_sem* ready;
+	SDL_atomic_t quit;
+	i32 framesSkipped;
+
+	Arena canvasArena;
+	RasterTarget canvas;
+	RenderFrame* presenting;
+	SDL_atomic_t presentPending;
+	SDL_sem* presented;
+	u32 presentEventType; // NOTE(khvorov) Wakes the ui thread up to present
+} RenderQueue;
+
+// NOTE(khvorov) Same number of pixels as 64x64 but square tiles make every row
+// a short copy a whole pitch away from the last one, which is slower
+#define RASTER_TILE_WIDTH 256
+#define RASTER_TILE_HEIGHT 16
+#define RASTER_WORKERS_MAX 64
+
+// NOTE(khvorov) One tile's worth of a draw list. cmds are the indices of
+// the commands that overlap the tile, in draw order. Only the parts of the
+// tile inside one of the rects get drawn.
+typedef struct RasterTile {
+	RasterTarget target;
+	DrawList* list;
+	SDL_Rect rect;
+	SDL_Rect* rects;
+	i32 rectCount;
+	i32* cmds;
+	i32 cmdCount;
+} RasterTile;
+
+// NOTE(khvorov) Draw lists are binned into tiles and the workers take tiles off
+// a shared counter until there are none left. Tiles never overlap, so nothing
+// needs a lock. The render thread draws tiles too instead of waiting. Tiles
+// nothing was damaged in are never made.
+typedef struct RasterPool {
+	b32 enabled;
+	b32 hasSSE2;
+	Arena arena; // NOTE(khvorov) Bins and tiles, reset every run
+	i32 tileCap;
+	i32 tileCount;
+	RasterTile* tiles;
+	SDL_atomic_t nextTile;
+
+	// NOTE(khvorov) What image and glyph commands read from
+	WindowCache* windowCaches;
+	u8* glyphCoverage;
+
+	i32 workerCount;
+	i32 activeWorkerCount; // NOTE(khvorov) How many of them to wake, the bench lowers it
+	SDL_Thread* workers[RASTER_WORKERS_MAX];
+	SDL_sem* start;
+	SDL_sem* done;
+	SDL_atomic_t quit;
+} RasterPool;
+
+// NOTE(khvorov) Windows docked to a side split the space their dock parent
+// has left, windows docked to the center become tabs next to it
 typedef enum DockPos {
 	DockPos_Center,
+	DockPos_Left,
+	DockPos_Right,
+	DockPos_Top,
+	DockPos_Bottom,
 	DockPos_Count,
 } DockPos;
 
-typedef struct UIWindow {
+// NOTE(khvorov) The dragged window can be docked to the edges of the screen or
+// to any side of the window under the cursor. The edge targets come first.
+#define UI_DOCK_EDGE_TARGETS 4
+#define UI_DOCK_TARGETS_MAX 9
+#define UI_TEAR_OFF_DISTANCE 4
+#define UI_DETACHED_MAX 16
+
+typedef struct UIDockTarget {
+	UIWindowID host;
+	DockPos pos;
 	SDL_Rect rect;
-	SDL_Color color;
+} UIDockTarget;
+
+typedef enum SpatialItemKind {
+	SpatialItemKind_Window,
+	SpatialItemKind_Splitter, // NOTE(khvorov) Between a side docked window and what's left of its parent
+} SpatialItemKind;
+
+typedef struct SpatialItem {
+	SpatialItemKind kind;
+	i32 id;
+} SpatialItem;
+
+typedef struct SpatialCell {
+	SpatialItem* items;
+	i32 count;
+	i32 cap;
+} SpatialCell;
+
+#define SPATIAL_CELL_SIZE 64
+
+// NOTE(khvorov) With this many items in a cell there are usually so many windows
+// piled over it that walking the z-order from the front hits one sooner than
+// looking at every item in the cell
+#define SPATIAL_CELL_CROWDED 32
+
+// NOTE(khvorov) Uniform grid over the screen. Every item is listed in all the
+// cells its rect overlaps. Callers remember the rect they inserted with so
+// that they can remove the item later.
+typedef struct SpatialGrid {
+	Arena* arena;
+	i32 cellsX, cellsY;
+	i32 cellCap;
+	SpatialCell* cells;
+} SpatialGrid;
+
+typedef enum GlyphState {
+	GlyphState_Empty,
+	GlyphState_Pending, // NOTE(khvorov) A worker has it, drawn as a placeholder until it comes back
+	GlyphState_Ready,
+	GlyphState_Missing, // NOTE(khvorov) Could not be rasterized or did not fit
+} GlyphState;
+
+typedef struct Glyph {
+	u32 codepoint;
+	GlyphState state;
+	SDL_Rect texRect;
+	i32 offsetX;
+	i32 offsetY;
+	i32 advance;
+} Glyph;
+
+#define GLYPH_TABLE_CAP 1024
+#define GLYPH_ATLAS_DIM 1024
+#define GLYPH_BITMAP_DIM 64
+#define GLYPH_QUEUE_CAP 256
+#define GLYPH_WORKERS_MAX 4
+#define GLYPH_UPLOADS_CAP 256
+
+// NOTE(khvorov) sequence is the result's index + 1 once the worker is done with it
+typedef struct GlyphBitmap {
+	SDL_atomic_t sequence;
+	u32 codepoint;
+	b32 rasterized;
+	i32 width;
+	i32 height;
+	i32 offsetX;
+	i32 offsetY;
+	i32 advance;
+	u8 coverage[GLYPH_BITMAP_DIM * GLYPH_BITMAP_DIM];
+} GlyphBitmap;
+
+// NOTE(khvorov) A glyph on its way into the atlas texture
+typedef struct GlyphUpload {
+	SDL_Rect texRect;
+	u8 coverage[GLYPH_BITMAP_DIM * GLYPH_BITMAP_DIM];
+} GlyphUpload;
+
+// NOTE(khvorov) FreeType faces can't be shared between threads so every
+// worker opens its own from the same font file in memory
+typedef struct GlyphWorker {
+	struct Font* font;
+	SDL_Thread* thread;
+	FT_Library ftLibrary;
+	FT_Face ftFace;
+} GlyphWorker;
+
+// NOTE(khvorov) Glyphs are rasterized by the workers the first time they are
+// asked for and packed into the atlas in rows when they come back. Nothing is
+// ever evicted, so once the atlas or the table fills up new glyphs are just not
+// drawn. The ui thread is the only one that writes requests and the only one
+// that reads results, so the queues need no locks. At most GLYPH_QUEUE_CAP
+// glyphs are in flight, which means neither queue can wrap onto a live slot.
+typedef struct Font {
+	FT_Library ftLibrary;
+	FT_Face ftFace;
+	void* fileData;
+	size_t fileSize;
+	i32 pixelHeight;
+	i32 ascender;
+	i32 lineHeight;
+
+	// NOTE(khvorov) The glyph atlas as coverage only. The cpu rasterizer reads
+	// it as is and the renderer turns it into its atlas texture. The ui thread
+	// writes it as glyphs are packed, before any frame that draws them is
+	// published, and packed rects are never reused, so any number of render
+	// threads can read it without a lock.
+	u8* atlasCoverage;
+	i32 atlasPackX;
+	i32 atlasPackY;
+	i32 atlasRowHeight;
+	b32 atlasFull;
 
-	b32 isDragged;
-	i32 dragOffsetFromTopleftX;
-	i32 dragOffsetFromTopleftY;
+	// NOTE(khvorov) The atlas texture belongs to whoever renders, so the ui
+	// thread packs glyphs and queues their pixels here for the renderer to
+	// copy in before it draws anything. Tiles drain the queue without a texture.
+	GlyphUpload* uploads;
+	SDL_atomic_t uploadsWritten;
+	SDL_atomic_t uploadsRead;
+	u32* uploadPixels;
 
-	b32 isDocked;
-	DockPos dockPos;
-	UIWindowID dockParent;
-} UIWindow;
+	i32 glyphCount;
+	Glyph glyphs[GLYPH_TABLE_CAP];
+
+	i32 inFlight;
+	u32 requests[GLYPH_QUEUE_CAP];
+	u32 requestsWritten;
+	SDL_atomic_t requestsRead;
+	SDL_sem* requestSem;
+	GlyphBitmap* results;
+	SDL_atomic_t resultsWritten;
+	u32 resultsRead;
+
+	SDL_atomic_t quit;
+	u32 wakeEventType;
+	i32 workerCount;
+	GlyphWorker workers[GLYPH_WORKERS_MAX];
+
+	// NOTE(khvorov) Where placeholders were drawn, to be redrawn once glyphs arrive
+	Damage placeholderDamage;
+} Font;
+
+#define UI_WINDOW_TITLE_CAP 32
+
+typedef struct UIWindowTitle {
+	char chars[UI_WINDOW_TITLE_CAP];
+	i32 len;
+} UIWindowTitle;
+
+typedef enum UIWindowContent {
+	UIWindowContent_None,
+	UIWindowContent_Profiler,
+	UIWindowContent_List,
+} UIWindowContent;
+
+// NOTE(khvorov) Writes the row's text into buf and returns its length
+typedef i32 (*UIListGetRow)(void* data, i64 row, char* buf, i32 bufCap);
+
+// NOTE(khvorov) Rows all have the same height so the visible ones follow
+// from the scroll position alone and nothing is stored per row
+typedef struct UIList {
+	i64 rowCount;
+	i64 scrollY;
+	UIListGetRow getRow;
+	void* getRowData;
+} UIList;
+
+typedef enum UIWindowPart {
+	UIWindowPart_None,
+	UIWindowPart_Border,
+	UIWindowPart_Topbar,
+	UIWindowPart_Content,
+} UIWindowPart;
+
+// NOTE(khvorov) What the last drawn frame shows at each pixel, so that
+// pointer queries are a lookup. Bits 0-1 are the window part, 2-5 the index of
+// the dock target drawn on top (UI_DOCK_TARGETS_MAX for none), the rest the window ID + 1
+// (0 for background). Rewritten only where the screen is redrawn.
+typedef u32 PickID;
+
+#define PICK_PART_BITS 2
+#define PICK_DOCK_BITS 4
+
+typedef struct PickBuffer {
+	Arena arena;
+	b32 enabled;
+	i32 width, height;
+	PickID* ids;
+} PickBuffer;
+
+typedef struct UIPick {
+	UIWindowID window;
+	UIWindowPart part;
+	i32 dockTarget; // NOTE(khvorov) Index into the ui's dock targets, -1 for none
+} UIPick;
+
+typedef enum UIWindowFlag {
+	UIWindowFlag_Alive = 1 << 0,
+	UIWindowFlag_Docked = 1 << 1,
+	UIWindowFlag_Dragged = 1 << 2,
+	UIWindowFlag_LayoutDirty = 1 << 3,
+	UIWindowFlag_Detached = 1 << 4,
+} UIWindowFlag;
+
+// NOTE(khvorov) Struct of arrays indexed by UIWindowID. The arrays before
+// colors are read for every window every frame, the rest only occasionally.
+// Destroyed slots go on a free list and get their generation bumped.
+typedef struct UIWindows {
+	i32 cap;
+	i32 slotCount;
+	i32 liveCount;
+	UIWindowID firstFree;
+
+	// NOTE(khvorov) Z-order is a doubly linked list through inFront/behind.
+	// zKeys only ever grow towards the front and shrink towards the back so
+	// that any two windows can be compared without walking the list.
+	UIWindowID front;
+	UIWindowID back;
+	i32 zTop;
+	i32 zBottom;
+
+	// NOTE(khvorov) Docked windows form a tree under their dock parents
+	// (UIWindowID_Root for the screen). Layout rects are recomputed only
+	// for windows on the dirty list and the parts of their subtrees whose
+	// dock areas changed.
+	i32 layoutDirtyCount;
+	UIWindowID* layoutDirtyList;
+
+	SDL_Rect* rects; // NOTE(khvorov) Where the window is when it's floating
+	SDL_Rect* layoutRects;
+	u32* flags;
+	UIWindowID* dockParents;
+	DockPos* dockPositions;
+	UIWindowID* dockFirstChildren;
+	UIWindowID* dockNextSiblings;
+	UIWindowID* dockPrevSiblings;
+	SDL_Rect* dockAreas; // NOTE(khvorov) What the dock parent gave the window, children are carved out of it
+	SDL_Rect* dockSpaces; // NOTE(khvorov) What the parent had left when a side docked window took its slice
+	f32* dockFractions; // NOTE(khvorov) How much of its dock space a side docked window takes
+	UIWindowID* inFront;
+	UIWindowID* behind;
+	i32* zKeys;
+	SDL_Rect* topbarRects;
+	SDL_Rect* contentRects;
+	SDL_Rect* tabRects; // NOTE(khvorov) The window's part of the topbar it shares with its tabs
+
+	SDL_Color* colors;
+	UIWindowTitle* titles;
+	UIWindowContent* contents;
+	UIList* lists;
+	SDL_Rect* dirtyRects; // NOTE(khvorov) Window relative, what changed since the window was last rendered
+	SDL_Rect* spatialRects;
+	SDL_Rect* splitterRects;
+	SDL_Point* dragOffsets;
+	i32* generations;
+	UIWindowID* nextFree;
+} UIWindows;
 
 typedef struct UI {
+	Arena* arena;
 	i32 width, height;
 	i32 windowTopBarHeight;
 	i32 windowBorderThickness;
-	UIWindowID windowOrder[UIWindowID_Count]; // NOTE(khvorov) First window is drawn last (on top)
-	UIWindow windows[UIWindowID_Count];
+	UIWindows windows;
+	UIWindowID draggedWindow;
+	SDL_Point dragStart;
+	UIWindowID draggedSplitter;
+	UIWindowHandle profilerWindow;
+	UIWindowHandle listDemoWindow;
+	UIWindowID scrollDraggedWindow;
+	i32 scrollDragGrabY;
+	i32 listRowHeight;
+	i32 scrollbarWidth;
+	UIWindowID rootDockFirstChild;
+	b32 rootLayoutDirty;
+	SpatialGrid spatial;
+	i32 dockTargetCount;
+	UIDockTarget dockTargets[UI_DOCK_TARGETS_MAX];
+
+	// NOTE(khvorov) Windows torn off into os windows of their own. The app
+	// keeps one os window for each and says which one has the cursor.
+	i32 detachedCount;
+	UIWindowID detachedWindows[UI_DETACHED_MAX];
+	UIWindowID cursorDetachedWindow;
+
+	Damage damage;
+	PickBuffer pick;
 } UI;
 
-void
-uiInit(UI* ui) {
-	SDL_memset(ui, 0, sizeof(UI));
+typedef enum ScanKernel {
+	ScanKernel_Scalar,
+	ScanKernel_SSE2,
+	ScanKernel_AVX2,
+	ScanKernel_Count,
+} ScanKernel;
 
-	for (i32 id = 0; id < UIWindowID_Count; id += 1) {
-		ui->windowOrder[id] = id;
-	}
+typedef enum ScanMatch {
+	ScanMatch_Bytes, // NOTE(khvorov) Any of the query bytes, for newlines and delimiters
+	ScanMatch_Utf8Start, // NOTE(khvorov) Anything but a continuation byte
+} ScanMatch;
 
-	{
-		UIWindow win = {.rect = {.x = 0, .y = 0, .w = 200, .h = 100}, .color = {.r = 255, .g = 0, .b = 0, .a = 255}};
-		ui->windows[UIWindowID_1] = win;
-	}
+#define SCAN_QUERY_BYTES_MAX 4
 
-	{
-		UIWindow win = {.rect = {.x = 100, .y = 100, .w = 100, .h = 200}, .color = {.r = 0, .g = 255, .b = 0, .a = 255}};
-		ui->windows[UIWindowID_2] = win;
-	}
+typedef struct ScanQuery {
+	ScanMatch match;
+	i32 byteCount;
+	u8 bytes[SCAN_QUERY_BYTES_MAX];
+} ScanQuery;
 
-	ui->windowTopBarHeight = 20;
-	ui->windowBorderThickness = 2;
-}
+#define LINE_INDEX_CHUNK_LINES 4096
+
+// NOTE(khvorov) Line starts are stored as 32-bit offsets from the start of
+// their chunk, so the index costs 4 bytes a line no matter how big the file
+// is. A chunk is cut short if its lines span more than 4 GB.
+typedef struct LineIndexChunk {
+	i64 firstLine;
+	i64 baseOffset;
+	u32* offsets;
+	SDL_atomic_t lineCount;
+} LineIndexChunk;
+
+// NOTE(khvorov) Written by the index thread only. A chunk is filled in before
+// chunkCount covers it and offsets are written before lineCount covers them,
+// so the ui thread can read whatever has been published without a lock.
+typedef struct LineIndex {
+	Arena chunkArena;
+	Arena offsetArena;
+	LineIndexChunk* chunks;
+	SDL_atomic_t chunkCount;
+	SDL_atomic_t done;
+} LineIndex;
+
+#define FILE_VIEW_GOTO_CAP 24
+
+typedef struct FileView {
+	char* name;
+	u8* data;
+	i64 size;
+	LineIndex index;
+	SDL_Thread* indexThread;
+	SDL_atomic_t quit;
+	u32 wakeEventType;
+	ScanKernel scanKernel;
+	u64 indexStart;
+	UIWindowHandle window;
+	i32 titlePercent;
+	char gotoText[FILE_VIEW_GOTO_CAP];
+	i32 gotoLen;
+} FileView;
 
 b32
 pointInRect(i32 pointX, i32 pointY, SDL_Rect rect) {
@@ -115,6 +784,43 @@ rectShrink(SDL_Rect rect, i32 by) {
 	return result;
 }
 
+i32
+rectArea(SDL_Rect rect) {
+	i32 result = 0;
+	if (rect.w > 0 && rect.h > 0) {
+		result = rect.w * rect.h;
+	}
+	return result;
+}
+
+b32
+rectsIntersect(SDL_Rect rect1, SDL_Rect rect2) {
+	b32 inX = rect1.x < rect2.x + rect2.w && rect2.x < rect1.x + rect1.w;
+	b32 inY = rect1.y < rect2.y + rect2.h && rect2.y < rect1.y + rect1.h;
+	b32 result = inX && inY;
+	return result;
+}
+
+SDL_Rect
+rectUnion(SDL_Rect rect1, SDL_Rect rect2) {
+	SDL_Rect result;
+	SDL_UnionRect(&rect1, &rect2, &result);
+	return result;
+}
+
+SDL_Rect
+rectIntersect(SDL_Rect rect1, SDL_Rect rect2) {
+	SDL_Rect result = {0};
+	SDL_IntersectRect(&rect1, &rect2, &result);
+	return result;
+}
+
+b32
+rectsEqual(SDL_Rect rect1, SDL_Rect rect2) {
+	b32 result = rect1.x == rect2.x && rect1.y == rect2.y && rect1.w == rect2.w && rect1.h == rect2.h;
+	return result;
+}
+
 void
 getOutlineRects(SDL_Rect rect, SDL_Rect* rects, i32 thickness) {
 	SDL_Rect top = rect;
@@ -135,222 +841,4979 @@ getOutlineRects(SDL_Rect rect, SDL_Rect* rects, i32 thickness) {
 	rects[Direction_Left] = left;
 }
 
-void
-clearHalfTransitionCounts(Input* input) {
-	for (i32 keyIndex = 0; keyIndex < InputKeyID_Count; keyIndex += 1) {
-		InputKey* key = input->keys + keyIndex;
-		key->halfTransitionCount = 0;
-	}
-}
-
-void
-recordKey(Input* input, InputKeyID keyID, b32 down) {
-	InputKey* key = input->keys + keyID;
-	key->halfTransitionCount += 1;
-	key->endedDown = down;
-}
+// NOTE(khvorov) Arenas reserve a big range of address space up front and
+// commit it as they grow, so that nothing they hand out ever moves
+#define ARENA_COMMIT_GRANULARITY (64 * 1024)
+#define ARENA_ALIGNMENT 16
 
-b32
-wasPressed(Input* input, InputKeyID keyID) {
-	InputKey* key = input->keys + keyID;
-	b32 result = key->halfTransitionCount > 1 || (key->halfTransitionCount == 1 && key->endedDown);
+void*
+vmReserve(size_t size) {
+#ifdef _WIN32
+	void* result = VirtualAlloc(0, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+	void* result = mmap(0, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (result == MAP_FAILED) {
+		result = 0;
+	}
+#endif
 	return result;
 }
 
 b32
-wasUnpressed(Input* input, InputKeyID keyID) {
-	InputKey* key = input->keys + keyID;
-	b32 result = key->halfTransitionCount > 1 || (key->halfTransitionCount == 1 && !key->endedDown);
+vmCommit(void* ptr, size_t size) {
+#ifdef _WIN32
+	b32 result = VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != 0;
+#else
+	b32 result = mprotect(ptr, size, PROT_READ | PROT_WRITE) == 0;
+#endif
 	return result;
 }
 
 void
-uiGetRootDockRects(UI* ui, SDL_Rect* rects) {
-	rects[DockPos_Center] = rectCenterDim(ui->width / 2, ui->height / 2, 100, 100);
+vmRelease(void* ptr, size_t size) {
+#ifdef _WIN32
+	VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+	munmap(ptr, size);
+#endif
 }
 
-void
-uiMoveWindowToFront(UI* ui, UIWindowID winID) {
-	i32 winOrderIndex = 0;
-	for (; winOrderIndex < UIWindowID_Count; winOrderIndex++) {
-		if (ui->windowOrder[winOrderIndex] == winID) {
-			break;
+// NOTE(khvorov) Read-only view of a whole file. Pages are only read in when
+// touched so this is cheap no matter how big the file is.
+u8*
+fileMapReadOnly(char* path, i64* size) {
+	u8* result = 0;
+	*size = 0;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER fileSize;
+		if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+			HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+			if (mapping) {
+				result = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				if (result) {
+					*size = fileSize.QuadPart;
+				}
+				CloseHandle(mapping);
+			}
 		}
+		CloseHandle(file);
 	}
-
-	if (winOrderIndex < UIWindowID_Count) {
-		for (; winOrderIndex > 0; winOrderIndex--) {
-			ui->windowOrder[winOrderIndex] = ui->windowOrder[winOrderIndex - 1];
-			ui->windowOrder[winOrderIndex - 1] = winID;
+#else
+	int file = open(path, O_RDONLY);
+	if (file != -1) {
+		struct stat fileStat;
+		if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0) {
+			result = mmap(0, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+			if (result == MAP_FAILED) {
+				result = 0;
+			} else {
+				*size = fileStat.st_size;
+			}
 		}
+		close(file);
 	}
+#endif
+	return result;
 }
 
-SDL_Rect
-uiGetWindowRect(UI* ui, UIWindowID winID) {
-	SDL_Rect winRect = {.x = 0, .y = 0, .w = ui->width, .h = ui->height};
-	if (winID >= 0 && winID < UIWindowID_Count) {
-		UIWindow* win = ui->windows + winID;
-		winRect = win->rect;
-		if (win->isDocked) {
-			SDL_Rect parentRect = uiGetWindowRect(ui, win->dockParent);
+void
+fileUnmap(u8* data, i64 size) {
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+#else
+	munmap(data, (size_t)size);
+#endif
+}
 
-			switch (win->dockPos) {
-			case DockPos_Center: {winRect = parentRect;} break;
-			}
-		}
+b32
+arenaInit(Arena* arena, char* name, size_t reserveSize) {
+	SDL_memset(arena, 0, sizeof(Arena));
+	arena->name = name;
+	arena->base = vmReserve(reserveSize);
+	if (arena->base) {
+		arena->reserved = reserveSize;
+	} else {
+		SDL_Log("arena %s: could not reserve %d MB", name, (i32)(reserveSize / (1024 * 1024)));
 	}
-	return winRect;
+	return arena->base != 0;
 }
 
-SDL_Rect
-uiGetWindowTopbarRect(UI* ui, UIWindowID winID) {
-	SDL_Rect winRect = uiGetWindowRect(ui, winID);
-	SDL_Rect topBarRect = rectShrink(winRect, ui->windowBorderThickness);
-	topBarRect.h = ui->windowTopBarHeight;
-	return topBarRect;
+void
+arenaRelease(Arena* arena) {
+#ifdef WIREDECK_DEBUG
+	SDL_Log("arena %s: high water %d KB of %d KB reserved", arena->name, (i32)(arena->highWater / 1024), (i32)(arena->reserved / 1024));
+#endif
+	if (arena->base) {
+		vmRelease(arena->base, arena->reserved);
+	}
+	SDL_memset(arena, 0, sizeof(Arena));
 }
 
-SDL_Rect
-uiGetWindowContentRect(UI* ui, UIWindowID winID) {
-	SDL_Rect winRect = uiGetWindowRect(ui, winID);
-	SDL_Rect contentRect = rectShrink(winRect, ui->windowBorderThickness);
-	contentRect.h -= ui->windowTopBarHeight;
-	contentRect.y += ui->windowTopBarHeight;
-	return contentRect;
+// NOTE(khvorov) Nobody checks what an arena or reallocArray hands out, so
+// there is nothing to return to. Asserts are compiled out in the default build
+// so this is not one.
+void
+exitOutOfMemory(void) {
+#ifdef _WIN32
+	ExitProcess(1);
+#else
+	_exit(1);
+#endif
 }
 
 void
-uiWindowUpdate(UI* ui, UIWindowID winID, Input* input) {
+arenaOutOfMemory(Arena* arena, size_t size, char* what) {
+	SDL_LogCritical(
+		SDL_LOG_CATEGORY_APPLICATION, "arena %s: %s for %lld bytes, %lld used of %lld reserved",
+		arena->name, what, (long long)size, (long long)arena->used, (long long)arena->reserved
+	);
+	exitOutOfMemory();
+}
 
-	UIWindow* win = ui->windows + winID;
-	SDL_Rect winRect = uiGetWindowRect(ui, winID);
+// NOTE(khvorov) For things outside the frame loop that don't have an arena
+void*
+reallocArray(void* ptr, i32 count, i32 elementSize) {
+	size_t size = (size_t)count * (size_t)elementSize;
+	void* result = SDL_realloc(ptr, size);
+	if (!result && size > 0) {
+		SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "realloc failed for %lld bytes", (long long)size);
+		exitOutOfMemory();
+	}
+	return result;
+}
 
-	if (wasPressed(input, InputKeyID_MouseLeft)) {
+void*
+arenaAlloc(Arena* arena, size_t size) {
+	size_t start = (arena->used + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+	size_t end = start + size;
+	if (end < start || end > arena->reserved) {
+		arenaOutOfMemory(arena, size, "out of reserved space");
+	}
 
-		if (pointInRect(input->cursorX, input->cursorY, winRect)) {
-			uiMoveWindowToFront(ui, winID);
-			input->keys[InputKeyID_MouseLeft].halfTransitionCount = 0;
+	if (end > arena->committed) {
+		size_t newCommitted = (end + ARENA_COMMIT_GRANULARITY - 1) & ~(size_t)(ARENA_COMMIT_GRANULARITY - 1);
+		newCommitted = SDL_min(newCommitted, arena->reserved);
+		if (!vmCommit(arena->base + arena->committed, newCommitted - arena->committed)) {
+			arenaOutOfMemory(arena, size, "could not commit");
 		}
+		arena->committed = newCommitted;
+	}
+
+	arena->used = end;
+	arena->highWater = SDL_max(arena->highWater, end);
+	void* result = arena->base + start;
+	return result;
+}
 
-		// NOTE(khvorov) Dragging
-		SDL_Rect windowTopbarRect = uiGetWindowTopbarRect(ui, winID);
-		if (pointInRect(input->cursorX, input->cursorY, windowTopbarRect)) {
+// NOTE(khvorov) Extends in place when ptr is the last thing allocated,
+// otherwise copies and leaves the old array behind until the arena is reset
+void*
+arenaGrowArray(Arena* arena, void* ptr, i32 oldCount, i32 newCount, i32 elementSize) {
+	size_t oldSize = (size_t)oldCount * (size_t)elementSize;
+	size_t newSize = (size_t)newCount * (size_t)elementSize;
+	void* result = 0;
+	if (ptr && (u8*)ptr + oldSize == arena->base + arena->used) {
+		arena->used -= oldSize;
+		result = arenaAlloc(arena, newSize);
+		SDL_assert(result == ptr);
+	} else {
+		result = arenaAlloc(arena, newSize);
+		if (ptr) {
+			SDL_memcpy(result, ptr, oldSize);
+		}
+	}
+	return result;
+}
 
-			if (win->isDocked) {
-				win->isDocked = false;
-				win->dockPos = 0;
-				win->dockParent = 0;
+void
+arenaReset(Arena* arena) {
+	arena->used = 0;
+}
 
-				f32 clickX01 = (f32)(input->cursorX - winRect.x) / (f32)windowTopbarRect.w;
-				i32 clickYOffset = input->cursorY - winRect.y;
+void
+damageAdd(Damage* damage, SDL_Rect rect) {
+	if (rectArea(rect) > 0) {
 
-				SDL_Rect newTopBar = uiGetWindowTopbarRect(ui, winID);
-				win->rect.x = input->cursorX - ui->windowBorderThickness - (i32)(clickX01 * (f32)newTopBar.w);
-				win->rect.y = input->cursorY - clickYOffset;
+		// NOTE(khvorov) Absorb every rect the new one overlaps. The union can grow
+		// into rects it didn't overlap before so keep going until nothing changes.
+		for (i32 rectIndex = 0; rectIndex < damage->count;) {
+			SDL_Rect existing = damage->rects[rectIndex];
+			if (rectsIntersect(existing, rect)) {
+				rect = rectUnion(existing, rect);
+				damage->rects[rectIndex] = damage->rects[--damage->count];
+				rectIndex = 0;
+			} else {
+				rectIndex += 1;
 			}
-
-			win->isDragged = true;
-			win->dragOffsetFromTopleftX = input->cursorX - win->rect.x;
-			win->dragOffsetFromTopleftY = input->cursorY - win->rect.y;
-			win->color.b = 255;
 		}
 
-	} else if (wasUnpressed(input, InputKeyID_MouseLeft) && win->isDragged) {
-
-		SDL_Rect rootDockRects[DockPos_Count];
-		uiGetRootDockRects(ui, rootDockRects);
-		for (DockPos pos = 0; pos < DockPos_Count; pos++) {
-			SDL_Rect rect = rootDockRects[pos];
-			if (pointInRect(input->cursorX, input->cursorY, rect)) {
-				win->isDocked = true;
-				win->dockPos = pos;
-				win->dockParent = UIWindowID_Root;
+		if (damage->count == DAMAGE_RECTS_MAX) {
+			i32 bestIndex = 0;
+			i32 bestGrowth = INT32_MAX;
+			for (i32 rectIndex = 0; rectIndex < damage->count; rectIndex++) {
+				SDL_Rect existing = damage->rects[rectIndex];
+				i32 growth = rectArea(rectUnion(existing, rect)) - rectArea(existing);
+				if (growth < bestGrowth) {
+					bestGrowth = growth;
+					bestIndex = rectIndex;
+				}
 			}
+			rect = rectUnion(damage->rects[bestIndex], rect);
+			damage->rects[bestIndex] = damage->rects[--damage->count];
+			damageAdd(damage, rect);
+		} else {
+			damage->rects[damage->count++] = rect;
 		}
-
-		win->isDragged = false;
-		win->dragOffsetFromTopleftX = 0;
-		win->dragOffsetFromTopleftY = 0;
-		win->color.b = 0;
 	}
+}
 
-	if (win->isDragged) {
-		win->rect.x = input->cursorX - win->dragOffsetFromTopleftX;
-		win->rect.y = input->cursorY - win->dragOffsetFromTopleftY;
+// NOTE(khvorov) Writes the parts of rect outside of cut, at most 4 of them
+i32
+rectSubtract(SDL_Rect rect, SDL_Rect cut, SDL_Rect* pieces) {
+	i32 result = 0;
+	SDL_Rect overlap = rectIntersect(rect, cut);
+	if (rectArea(overlap) == 0) {
+		pieces[result++] = rect;
+	} else {
+		i32 rectBottom = rect.y + rect.h;
+		i32 overlapBottom = overlap.y + overlap.h;
+		if (overlap.y > rect.y) {
+			pieces[result++] = (SDL_Rect) {.x = rect.x, .y = rect.y, .w = rect.w, .h = overlap.y - rect.y};
+		}
+		if (overlapBottom < rectBottom) {
+			pieces[result++] = (SDL_Rect) {.x = rect.x, .y = overlapBottom, .w = rect.w, .h = rectBottom - overlapBottom};
+		}
+		if (overlap.x > rect.x) {
+			pieces[result++] = (SDL_Rect) {.x = rect.x, .y = overlap.y, .w = overlap.x - rect.x, .h = overlap.h};
+		}
+		if (overlap.x + overlap.w < rect.x + rect.w) {
+			pieces[result++] = (SDL_Rect) {.x = overlap.x + overlap.w, .y = overlap.y, .w = rect.x + rect.w - overlap.x - overlap.w, .h = overlap.h};
+		}
 	}
+	return result;
 }
 
+// NOTE(khvorov) If the pieces don't fit the region is left as it was, which
+// only means drawing more than needed
 void
-drawRect(SDL_Renderer* sdlRenderer, SDL_Rect rect, SDL_Color color) {
-	SDL_SetRenderDrawColor(sdlRenderer, color.r, color.g, color.b, color.a);
-	SDL_RenderFillRect(sdlRenderer, &rect);
+regionSubtract(Region* region, SDL_Rect cut) {
+	Region result = {0};
+	b32 fits = true;
+	for (i32 rectIndex = 0; rectIndex < region->count && fits; rectIndex++) {
+		SDL_Rect pieces[4];
+		i32 pieceCount = rectSubtract(region->rects[rectIndex], cut, pieces);
+		fits = result.count + pieceCount <= REGION_RECTS_MAX;
+		for (i32 pieceIndex = 0; pieceIndex < pieceCount && fits; pieceIndex++) {
+			result.rects[result.count++] = pieces[pieceIndex];
+		}
+	}
+	if (fits) {
+		*region = result;
+	}
 }
 
 void
-drawRectOutline(SDL_Renderer* sdlRenderer, SDL_Rect rect, SDL_Color color, i32 thickness) {
-	SDL_Rect outlineRects[Direction_Count];
-	getOutlineRects(rect, outlineRects, thickness);
-	for (Direction dir = 0; dir < Direction_Count; dir++) {
-		SDL_Rect outlineRect = outlineRects[dir];
-		drawRect(sdlRenderer, outlineRect, color);
+regionIntersectRect(Region* region, SDL_Rect rect, Region* out) {
+	out->count = 0;
+	for (i32 rectIndex = 0; rectIndex < region->count; rectIndex++) {
+		SDL_Rect overlap = rectIntersect(region->rects[rectIndex], rect);
+		if (rectArea(overlap) > 0) {
+			out->rects[out->count++] = overlap;
+		}
 	}
 }
 
-void
-drawWindow(SDL_Renderer* sdlRenderer, UI* ui, UIWindowID winID) {
-	UIWindow* win = ui->windows + winID;
+i32
+regionGetArea(Region* region) {
+	i32 result = 0;
+	for (i32 rectIndex = 0; rectIndex < region->count; rectIndex++) {
+		result += rectArea(region->rects[rectIndex]);
+	}
+	return result;
+}
 
-	SDL_Rect winRect = uiGetWindowRect(ui, winID);
-	SDL_Color windowOutlineColor = {.r = 100, .g = 100, .b = 100, .a = 255};
-	drawRectOutline(sdlRenderer, winRect, windowOutlineColor, ui->windowBorderThickness);
+void
+damageClear(Damage* damage) {
+	damage->count = 0;
+}
 
-	SDL_Rect topBarRect = uiGetWindowTopbarRect(ui, winID);
-	drawRect(sdlRenderer, topBarRect, win->color);
+b32
+damageIntersects(Damage* damage, SDL_Rect rect) {
+	b32 result = false;
+	for (i32 rectIndex = 0; rectIndex < damage->count && !result; rectIndex++) {
+		result = rectsIntersect(damage->rects[rectIndex], rect);
+	}
+	return result;
+}
 
-	SDL_Rect contentRect = uiGetWindowContentRect(ui, winID);
-	SDL_Color contentRectBGColor = {.r = 0, .g = 0, .b = 0, .a = 255};
-	drawRect(sdlRenderer, contentRect, contentRectBGColor);
+i32
+damageGetPixelCount(Damage* damage) {
+	i32 result = 0;
+	for (i32 rectIndex = 0; rectIndex < damage->count; rectIndex++) {
+		result += rectArea(damage->rects[rectIndex]);
+	}
+	return result;
 }
 
 void
-processEvent(SDL_Window* window, SDL_Event* event, b32* running, Input* input) {
+spatialReset(SpatialGrid* grid, i32 width, i32 height) {
+	i32 oldCellCount = grid->cellsX * grid->cellsY;
+	for (i32 cellIndex = 0; cellIndex < oldCellCount; cellIndex++) {
+		grid->cells[cellIndex].count = 0;
+	}
 
-	switch (event->type) {
-	case SDL_QUIT: {*running = false;} break;
+	i32 cellsX = (width + SPATIAL_CELL_SIZE - 1) / SPATIAL_CELL_SIZE;
+	i32 cellsY = (height + SPATIAL_CELL_SIZE - 1) / SPATIAL_CELL_SIZE;
+	i32 newCellCount = cellsX * cellsY;
+	if (newCellCount > grid->cellCap) {
+		grid->cells = arenaGrowArray(grid->arena, grid->cells, grid->cellCap, newCellCount, sizeof(*grid->cells));
+		SDL_memset(grid->cells + grid->cellCap, 0, (newCellCount - grid->cellCap) * sizeof(*grid->cells));
+		grid->cellCap = newCellCount;
+	}
+	grid->cellsX = cellsX;
+	grid->cellsY = cellsY;
+}
 
-	case SDL_WINDOWEVENT: {
-		if (event->window.event == SDL_WINDOWEVENT_CLOSE && event->window.windowID == SDL_GetWindowID(window)) {
-			*running = false;
+b32
+spatialGetCellRange(SpatialGrid* grid, SDL_Rect rect, SDL_Rect* cellRange) {
+	b32 result = false;
+	if (rectArea(rect) > 0 && grid->cellsX > 0 && grid->cellsY > 0) {
+		i32 left = SDL_max(rect.x, 0) / SPATIAL_CELL_SIZE;
+		i32 top = SDL_max(rect.y, 0) / SPATIAL_CELL_SIZE;
+		i32 right = SDL_min((rect.x + rect.w - 1) / SPATIAL_CELL_SIZE, grid->cellsX - 1);
+		i32 bottom = SDL_min((rect.y + rect.h - 1) / SPATIAL_CELL_SIZE, grid->cellsY - 1);
+		if (rect.x + rect.w > 0 && rect.y + rect.h > 0 && left <= right && top <= bottom) {
+			cellRange->x = left;
+			cellRange->y = top;
+			cellRange->w = right - left + 1;
+			cellRange->h = bottom - top + 1;
+			result = true;
 		}
-	} break;
-
-	case SDL_MOUSEMOTION: {
-		input->cursorX = event->motion.x;
-		input->cursorY = event->motion.y;
-	} break;
+	}
+	return result;
+}
 
-	case SDL_MOUSEBUTTONDOWN: case SDL_MOUSEBUTTONUP: {
-		b32 down = event->type == SDL_MOUSEBUTTONUP ? 0 : 1;
-		InputKeyID keyID = InputKeyID_Count;
-		switch (event->button.button) {
-		case SDL_BUTTON_LEFT: {keyID = InputKeyID_MouseLeft;} break;
-		}
-		if (keyID != InputKeyID_Count) {
-			recordKey(input, keyID, down);
+SpatialCell*
+spatialGetCell(SpatialGrid* grid, i32 pointX, i32 pointY) {
+	SpatialCell* result = 0;
+	if (pointX >= 0 && pointY >= 0) {
+		i32 cellX = pointX / SPATIAL_CELL_SIZE;
+		i32 cellY = pointY / SPATIAL_CELL_SIZE;
+		if (cellX < grid->cellsX && cellY < grid->cellsY) {
+			result = grid->cells + cellY * grid->cellsX + cellX;
 		}
 	}
-	}
+	return result;
 }
 
 void
-pollEvents(SDL_Window* window, b32* running, Input* input) {
-	SDL_Event event;
-	while (SDL_PollEvent(&event)) {
-		processEvent(window, &event, running, input);
+spatialInsert(SpatialGrid* grid, SpatialItem item, SDL_Rect rect) {
+	SDL_Rect cellRange;
+	if (spatialGetCellRange(grid, rect, &cellRange)) {
+		for (i32 cellY = cellRange.y; cellY < cellRange.y + cellRange.h; cellY++) {
+			for (i32 cellX = cellRange.x; cellX < cellRange.x + cellRange.w; cellX++) {
+				SpatialCell* cell = grid->cells + cellY * grid->cellsX + cellX;
+				if (cell->count == cell->cap) {
+					i32 newCap = cell->cap == 0 ? 8 : cell->cap * 2;
+					cell->items = arenaGrowArray(grid->arena, cell->items, cell->cap, newCap, sizeof(*cell->items));
+					cell->cap = newCap;
+				}
+				cell->items[cell->count++] = item;
+			}
+		}
+	}
+}
+
+void
+spatialRemove(SpatialGrid* grid, SpatialItem item, SDL_Rect rect) {
+	SDL_Rect cellRange;
+	if (spatialGetCellRange(grid, rect, &cellRange)) {
+		for (i32 cellY = cellRange.y; cellY < cellRange.y + cellRange.h; cellY++) {
+			for (i32 cellX = cellRange.x; cellX < cellRange.x + cellRange.w; cellX++) {
+				SpatialCell* cell = grid->cells + cellY * grid->cellsX + cellX;
+				for (i32 itemIndex = 0; itemIndex < cell->count; itemIndex++) {
+					SpatialItem existing = cell->items[itemIndex];
+					if (existing.kind == item.kind && existing.id == item.id) {
+						cell->items[itemIndex] = cell->items[--cell->count];
+						break;
+					}
+				}
+			}
+		}
+	}
+}
+
+Profiler globalProfiler;
+
+char*
+profileGetZoneName(ProfileZoneKind kind) {
+	char* result = "";
+	switch (kind) {
+	case ProfileZoneKind_Events: {result = "events";} break;
+	case ProfileZoneKind_PaceWait: {result = "pace wait";} break;
+	case ProfileZoneKind_Update: {result = "update";} break;
+	case ProfileZoneKind_Draw: {result = "draw";} break;
+	case ProfileZoneKind_Render: {result = "render";} break;
+	case ProfileZoneKind_Present: {result = "present";} break;
+	case ProfileZoneKind_InputToPresent: {result = "input to present";} break;
+	case ProfileZoneKind_Count: break;
+	}
+	return result;
+}
+
+SDL_Color
+profileGetZoneColor(ProfileZoneKind kind) {
+	SDL_Color result = {.r = 255, .g = 255, .b = 255, .a = 255};
+	switch (kind) {
+	case ProfileZoneKind_Events: {result = (SDL_Color) {.r = 200, .g = 200, .b = 50, .a = 255};} break;
+	case ProfileZoneKind_PaceWait: {result = (SDL_Color) {.r = 60, .g = 60, .b = 60, .a = 255};} break;
+	case ProfileZoneKind_Update: {result = (SDL_Color) {.r = 50, .g = 200, .b = 50, .a = 255};} break;
+	case ProfileZoneKind_Draw: {result = (SDL_Color) {.r = 50, .g = 120, .b = 220, .a = 255};} break;
+	case ProfileZoneKind_Render: {result = (SDL_Color) {.r = 160, .g = 90, .b = 220, .a = 255};} break;
+	case ProfileZoneKind_Present: {result = (SDL_Color) {.r = 220, .g = 80, .b = 50, .a = 255};} break;
+	case ProfileZoneKind_InputToPresent: {result = (SDL_Color) {.r = 240, .g = 240, .b = 240, .a = 255};} break;
+	case ProfileZoneKind_Count: break;
+	}
+	return result;
+}
+
+char*
+presentGetModeName(PresentMode mode) {
+	char* result = "";
+	switch (mode) {
+	case PresentMode_Immediate: {result = "immediate";} break;
+	case PresentMode_Capped: {result = "capped";} break;
+	case PresentMode_Spaced: {result = "spaced";} break;
+	case PresentMode_Count: break;
+	}
+	return result;
+}
+
+char*
+presentGetReasonName(PresentReason reason) {
+	char* result = "";
+	switch (reason) {
+	case PresentReason_Startup: {result = "startup";} break;
+	case PresentReason_Idle: {result = "idle";} break;
+	case PresentReason_Dragging: {result = "dragging";} break;
+	case PresentReason_DraggingSlowFrames: {result = "dragging, frames slower than a refresh";} break;
+	case PresentReason_Animating: {result = "animating";} break;
+	case PresentReason_AnimatingPresentBlocks: {result = "animating, present already blocks";} break;
+	case PresentReason_Count: break;
+	}
+	return result;
+}
+
+ProfileZone
+profileBegin(ProfileZoneKind kind) {
+	ProfileZone zone = {.kind = kind, .start = SDL_GetPerformanceCounter()};
+	return zone;
+}
+
+void
+profileEnd(ProfileZone zone) {
+	Profiler* profiler = &globalProfiler;
+	u32 index = (u32)SDL_AtomicAdd(&profiler->eventsWritten, 1);
+	ProfileEvent* event = profiler->events + (index & (PROFILE_EVENTS_CAP - 1));
+
+	SDL_AtomicSet(&event->sequence, 0);
+	SDL_MemoryBarrierRelease();
+	event->kind = zone.kind;
+	event->threadID = SDL_ThreadID();
+	event->start = zone.start;
+	event->end = SDL_GetPerformanceCounter();
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&event->sequence, (int)(index + 1));
+}
+
+b32
+profileReadEvent(u32 index, ProfileEvent* out) {
+	Profiler* profiler = &globalProfiler;
+	ProfileEvent* event = profiler->events + (index & (PROFILE_EVENTS_CAP - 1));
+
+	u32 sequenceBefore = (u32)SDL_AtomicGet(&event->sequence);
+	SDL_MemoryBarrierAcquire();
+	out->kind = event->kind;
+	out->threadID = event->threadID;
+	out->start = event->start;
+	out->end = event->end;
+	SDL_MemoryBarrierAcquire();
+	u32 sequenceAfter = (u32)SDL_AtomicGet(&event->sequence);
+
+	b32 result = sequenceBefore == index + 1 && sequenceAfter == sequenceBefore;
+	return result;
+}
+
+void
+profileSetCounter(ProfileCounterKind kind, f32 value) {
+	globalProfiler.counters[kind] = value;
+}
+
+void
+profileSetPresentMode(PresentMode mode, PresentReason reason) {
+	globalProfiler.presentMode = mode;
+	globalProfiler.presentReason = reason;
+	globalProfiler.presentSwitchFrame = globalProfiler.framesEnded;
+}
+
+// NOTE(khvorov) Called by whoever presents, right after the present returns
+void
+profileRecordInputToPresent(u64 inputTime) {
+	ProfileZone zone = {.kind = ProfileZoneKind_InputToPresent, .start = inputTime};
+	profileEnd(zone);
+	f64 ms = (f64)(SDL_GetPerformanceCounter() - inputTime) * 1000.0 / (f64)SDL_GetPerformanceFrequency();
+	i32 bucket = SDL_min((i32)ms, PROFILE_LATENCY_BUCKETS - 1);
+	SDL_AtomicAdd(&globalProfiler.inputToPresentCounts[bucket], 1);
+}
+
+// NOTE(khvorov) Upper bound of the bucket the percentile falls into, in ms.
+// Counts are copied out first so that a render thread adding to them midway
+// doesn't matter.
+i32
+profileGetInputToPresentPercentile(i32* counts, i32 total, i32 percent) {
+	i32 target = (i32)(((i64)total * percent + 99) / 100);
+	i32 seen = 0;
+	i32 result = 0;
+	for (i32 bucket = 0; bucket < PROFILE_LATENCY_BUCKETS && seen < target; bucket++) {
+		seen += counts[bucket];
+		result = bucket + 1;
+	}
+	return result;
+}
+
+i32
+profileCopyInputToPresentCounts(i32* counts) {
+	i32 total = 0;
+	for (i32 bucket = 0; bucket < PROFILE_LATENCY_BUCKETS; bucket++) {
+		counts[bucket] = SDL_AtomicGet(&globalProfiler.inputToPresentCounts[bucket]);
+		total += counts[bucket];
+	}
+	return total;
+}
+
+void
+profileLogInputToPresent(void) {
+	i32 counts[PROFILE_LATENCY_BUCKETS];
+	i32 total = profileCopyInputToPresentCounts(counts);
+	if (total > 0) {
+		SDL_Log(
+			"latency: input to present over %d frames, p50 %dms, p99 %dms", total,
+			profileGetInputToPresentPercentile(counts, total, 50), profileGetInputToPresentPercentile(counts, total, 99)
+		);
+		for (i32 bucket = 0; bucket < PROFILE_LATENCY_BUCKETS; bucket++) {
+			if (counts[bucket] > 0 && bucket == PROFILE_LATENCY_BUCKETS - 1) {
+				SDL_Log("latency: %dms or more: %d", bucket, counts[bucket]);
+			} else if (counts[bucket] > 0) {
+				SDL_Log("latency: %d-%dms: %d", bucket, bucket + 1, counts[bucket]);
+			}
+		}
+	}
+}
+
+// NOTE(khvorov) Adds up everything recorded since the last call into the next frame slot
+void
+profileEndFrame(void) {
+	Profiler* profiler = &globalProfiler;
+	ProfileFrame* frame = profiler->frames + (profiler->framesEnded % PROFILE_FRAMES_CAP);
+	SDL_memset(frame, 0, sizeof(ProfileFrame));
+	SDL_memcpy(frame->counters, profiler->counters, sizeof(frame->counters));
+
+	u32 eventsWritten = (u32)SDL_AtomicGet(&profiler->eventsWritten);
+	if (eventsWritten - profiler->eventsCollected > PROFILE_EVENTS_CAP) {
+		profiler->eventsCollected = eventsWritten - PROFILE_EVENTS_CAP;
+	}
+
+	for (; profiler->eventsCollected != eventsWritten; profiler->eventsCollected++) {
+		ProfileEvent event;
+		if (profileReadEvent(profiler->eventsCollected, &event)) {
+			u64 ticks = event.end - event.start;
+			if (event.kind == ProfileZoneKind_InputToPresent) {
+				frame->inputToPresentTicks = SDL_max(frame->inputToPresentTicks, ticks);
+			} else {
+				frame->zoneTicks[event.kind] += ticks;
+			}
+		}
+	}
+
+	profiler->framesEnded += 1;
+}
+
+void
+profileDumpChromeTrace(char* path) {
+	Profiler* profiler = &globalProfiler;
+	SDL_RWops* file = SDL_RWFromFile(path, "wb");
+	if (file) {
+		f64 ticksPerMicrosecond = (f64)SDL_GetPerformanceFrequency() / 1000000.0;
+
+		char* header = "{\"traceEvents\":[\n";
+		SDL_RWwrite(file, header, SDL_strlen(header), 1);
+
+		u32 eventsWritten = (u32)SDL_AtomicGet(&profiler->eventsWritten);
+		u32 firstEvent = eventsWritten > PROFILE_EVENTS_CAP ? eventsWritten - PROFILE_EVENTS_CAP : 0;
+		b32 first = true;
+		for (u32 eventIndex = firstEvent; eventIndex != eventsWritten; eventIndex++) {
+			ProfileEvent event;
+			if (profileReadEvent(eventIndex, &event)) {
+				char line[256];
+				i32 lineLen = SDL_snprintf(
+					line, sizeof(line),
+					"%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f}",
+					first ? "" : ",\n", profileGetZoneName(event.kind), event.threadID,
+					(f64)event.start / ticksPerMicrosecond, (f64)(event.end - event.start) / ticksPerMicrosecond
+				);
+				SDL_RWwrite(file, line, lineLen, 1);
+				first = false;
+			}
+		}
+
+		char* footer = "\n]}\n";
+		SDL_RWwrite(file, footer, SDL_strlen(footer), 1);
+		SDL_RWclose(file);
+		SDL_Log("profiler: wrote %s", path);
+	} else {
+		SDL_Log("profiler: could not open %s: %s", path, SDL_GetError());
+	}
+}
+
+// NOTE(khvorov) Returns the number of bytes consumed. Malformed input
+// decodes to U+FFFD one byte at a time.
+i32
+utf8Decode(char* str, i32 len, u32* codepoint) {
+	u8* bytes = (u8*)str;
+	i32 result = 1;
+	*codepoint = 0xFFFD;
+	if (bytes[0] < 0x80) {
+		*codepoint = bytes[0];
+	} else {
+		i32 seqLen = 0;
+		u32 value = 0;
+		if ((bytes[0] & 0xE0) == 0xC0) {
+			seqLen = 2;
+			value = bytes[0] & 0x1F;
+		} else if ((bytes[0] & 0xF0) == 0xE0) {
+			seqLen = 3;
+			value = bytes[0] & 0x0F;
+		} else if ((bytes[0] & 0xF8) == 0xF0) {
+			seqLen = 4;
+			value = bytes[0] & 0x07;
+		}
+
+		b32 valid = seqLen > 0 && seqLen <= len;
+		for (i32 byteIndex = 1; byteIndex < seqLen && valid; byteIndex++) {
+			valid = (bytes[byteIndex] & 0xC0) == 0x80;
+			value = (value << 6) | (bytes[byteIndex] & 0x3F);
+		}
+
+		if (valid) {
+			*codepoint = value;
+			result = seqLen;
+		}
+	}
+	return result;
+}
+
+b32
+glyphRasterize(FT_Face ftFace, u32 codepoint, GlyphBitmap* out) {
+	out->codepoint = codepoint;
+	out->rasterized = false;
+	if (FT_Load_Char(ftFace, codepoint, FT_LOAD_RENDER) == 0) {
+		FT_GlyphSlot ftGlyph = ftFace->glyph;
+		FT_Bitmap* bitmap = &ftGlyph->bitmap;
+		out->width = SDL_min((i32)bitmap->width, GLYPH_BITMAP_DIM);
+		out->height = SDL_min((i32)bitmap->rows, GLYPH_BITMAP_DIM);
+		out->offsetX = ftGlyph->bitmap_left;
+		out->offsetY = -ftGlyph->bitmap_top;
+		out->advance = (i32)(ftGlyph->advance.x >> 6);
+		for (i32 row = 0; row < out->height; row++) {
+			SDL_memcpy(out->coverage + row * out->width, bitmap->buffer + row * bitmap->pitch, out->width);
+		}
+		out->rasterized = true;
+	}
+	return out->rasterized;
+}
+
+int
+glyphWorkerMain(void* data) {
+	GlyphWorker* worker = (GlyphWorker*)data;
+	Font* font = worker->font;
+	for (;;) {
+		SDL_SemWait(font->requestSem);
+		if (SDL_AtomicGet(&font->quit)) {
+			break;
+		}
+
+		// NOTE(khvorov) The semaphore was posted after the request was written
+		u32 requestIndex = (u32)SDL_AtomicAdd(&font->requestsRead, 1);
+		u32 codepoint = font->requests[requestIndex % GLYPH_QUEUE_CAP];
+
+		u32 resultIndex = (u32)SDL_AtomicAdd(&font->resultsWritten, 1);
+		GlyphBitmap* result = font->results + (resultIndex % GLYPH_QUEUE_CAP);
+		glyphRasterize(worker->ftFace, codepoint, result);
+		SDL_MemoryBarrierRelease();
+		SDL_AtomicSet(&result->sequence, (int)(resultIndex + 1));
+
+		// NOTE(khvorov) The ui thread could be asleep in SDL_WaitEvent
+		SDL_Event wake = {.type = font->wakeEventType};
+		SDL_PushEvent(&wake);
+	}
+	return 0;
+}
+
+b32
+fontOpenFace(Font* font, FT_Library* ftLibrary, FT_Face* ftFace) {
+	b32 result = false;
+	if (FT_Init_FreeType(ftLibrary) == 0) {
+		if (FT_New_Memory_Face(*ftLibrary, font->fileData, (FT_Long)font->fileSize, 0, ftFace) == 0) {
+			result = FT_Set_Pixel_Sizes(*ftFace, 0, (FT_UInt)font->pixelHeight) == 0;
+		}
+	}
+	if (!result) {
+		*ftFace = 0;
+	}
+	return result;
+}
+
+void fontRequestGlyph(Font* font, u32 codepoint);
+
+b32
+fontInit(Font* font, Arena* arena, i32 pixelHeight) {
+	SDL_memset(font, 0, sizeof(Font));
+	font->pixelHeight = pixelHeight;
+
+	// NOTE(khvorov) WIREDECK_FONT overrides the platform default
+	char* path = SDL_getenv("WIREDECK_FONT");
+	char pathBuf[512];
+	if (!path) {
+#ifdef _WIN32
+		char* winDir = SDL_getenv("WINDIR");
+		SDL_snprintf(pathBuf, sizeof(pathBuf), "%s/Fonts/consola.ttf", winDir ? winDir : "C:/Windows");
+#else
+		SDL_snprintf(pathBuf, sizeof(pathBuf), "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf");
+#endif
+		path = pathBuf;
+	}
+
+	SDL_RWops* file = SDL_RWFromFile(path, "rb");
+	if (file) {
+		Sint64 fileSize = SDL_RWsize(file);
+		if (fileSize > 0) {
+			font->fileData = arenaAlloc(arena, (size_t)fileSize);
+			if (SDL_RWread(file, font->fileData, (size_t)fileSize, 1) == 1) {
+				font->fileSize = (size_t)fileSize;
+			} else {
+				font->fileData = 0;
+			}
+		}
+		SDL_RWclose(file);
+	}
+
+	b32 result = false;
+	if (!font->fileData) {
+		SDL_Log("text: could not load font %s: %s", path, SDL_GetError());
+	} else if (!fontOpenFace(font, &font->ftLibrary, &font->ftFace)) {
+		SDL_Log("text: could not open font %s at size %d", path, pixelHeight);
+	} else {
+		FT_Size_Metrics* metrics = &font->ftFace->size->metrics;
+		font->ascender = (i32)(metrics->ascender >> 6);
+		font->lineHeight = (i32)(metrics->height >> 6);
+		font->uploads = arenaAlloc(arena, GLYPH_UPLOADS_CAP * sizeof(GlyphUpload));
+		font->uploadPixels = arenaAlloc(arena, GLYPH_BITMAP_DIM * GLYPH_BITMAP_DIM * sizeof(u32));
+		font->atlasCoverage = arenaAlloc(arena, GLYPH_ATLAS_DIM * GLYPH_ATLAS_DIM);
+		SDL_memset(font->atlasCoverage, 0, GLYPH_ATLAS_DIM * GLYPH_ATLAS_DIM);
+		font->results = arenaAlloc(arena, GLYPH_QUEUE_CAP * sizeof(GlyphBitmap));
+		SDL_memset(font->results, 0, GLYPH_QUEUE_CAP * sizeof(GlyphBitmap));
+		result = true;
+	}
+
+	// NOTE(khvorov) Leave a core for the ui thread. Without workers glyphs
+	// are rasterized on the ui thread when they are requested.
+	if (result) {
+		font->requestSem = SDL_CreateSemaphore(0);
+		font->wakeEventType = SDL_RegisterEvents(1);
+		i32 workerCount = SDL_max(SDL_min(SDL_GetCPUCount() - 1, GLYPH_WORKERS_MAX), 1);
+		for (i32 workerIndex = 0; workerIndex < workerCount && font->requestSem && font->wakeEventType != (u32)-1; workerIndex++) {
+			GlyphWorker* worker = font->workers + font->workerCount;
+			worker->font = font;
+			if (fontOpenFace(font, &worker->ftLibrary, &worker->ftFace)) {
+				worker->thread = SDL_CreateThread(glyphWorkerMain, "glyph worker", worker);
+				if (worker->thread) {
+					font->workerCount += 1;
+				}
+			}
+		}
+
+		// NOTE(khvorov) Get ascii going before anything asks for it
+		for (u32 codepoint = 32; codepoint < 127; codepoint++) {
+			fontRequestGlyph(font, codepoint);
+		}
+	}
+
+	return result;
+}
+
+void
+fontDeinit(Font* font) {
+	SDL_AtomicSet(&font->quit, 1);
+	for (i32 workerIndex = 0; workerIndex < font->workerCount; workerIndex++) {
+		SDL_SemPost(font->requestSem);
+	}
+	for (i32 workerIndex = 0; workerIndex < font->workerCount; workerIndex++) {
+		GlyphWorker* worker = font->workers + workerIndex;
+		SDL_WaitThread(worker->thread, 0);
+		FT_Done_Face(worker->ftFace);
+		FT_Done_FreeType(worker->ftLibrary);
+	}
+	if (font->requestSem) {
+		SDL_DestroySemaphore(font->requestSem);
+	}
+	if (font->ftFace) {
+		FT_Done_Face(font->ftFace);
+	}
+	if (font->ftLibrary) {
+		FT_Done_FreeType(font->ftLibrary);
+	}
+	SDL_memset(font, 0, sizeof(Font));
+}
+
+Glyph*
+fontFindGlyphSlot(Font* font, u32 codepoint) {
+	u32 slot = (codepoint * 2654435761u) & (GLYPH_TABLE_CAP - 1);
+	while (font->glyphs[slot].state != GlyphState_Empty && font->glyphs[slot].codepoint != codepoint) {
+		slot = (slot + 1) & (GLYPH_TABLE_CAP - 1);
+	}
+	Glyph* result = font->glyphs + slot;
+	return result;
+}
+
+b32
+fontCanUpload(Font* font) {
+	u32 pending = (u32)SDL_AtomicGet(&font->uploadsWritten) - (u32)SDL_AtomicGet(&font->uploadsRead);
+	b32 result = pending < GLYPH_UPLOADS_CAP;
+	return result;
+}
+
+// NOTE(khvorov) Finds a spot in the atlas and queues the coverage for upload.
+// There has to be room in the queue.
+b32
+fontAtlasUpload(Font* font, GlyphBitmap* bitmap, SDL_Rect* texRect) {
+	i32 padding = 1;
+	if (font->atlasPackX + bitmap->width + padding > GLYPH_ATLAS_DIM) {
+		font->atlasPackX = 0;
+		font->atlasPackY += font->atlasRowHeight + padding;
+		font->atlasRowHeight = 0;
+	}
+
+	b32 result = false;
+	if (font->atlasPackY + bitmap->height + padding <= GLYPH_ATLAS_DIM) {
+		*texRect = (SDL_Rect) {.x = font->atlasPackX, .y = font->atlasPackY, .w = bitmap->width, .h = bitmap->height};
+		font->atlasPackX += bitmap->width + padding;
+		font->atlasRowHeight = SDL_max(font->atlasRowHeight, bitmap->height);
+
+		if (bitmap->width > 0 && bitmap->height > 0) {
+			u32 uploadIndex = (u32)SDL_AtomicGet(&font->uploadsWritten);
+			GlyphUpload* upload = font->uploads + (uploadIndex % GLYPH_UPLOADS_CAP);
+			upload->texRect = *texRect;
+			SDL_memcpy(upload->coverage, bitmap->coverage, bitmap->width * bitmap->height);
+			for (i32 row = 0; row < bitmap->height; row++) {
+				u8* dest = font->atlasCoverage + (texRect->y + row) * GLYPH_ATLAS_DIM + texRect->x;
+				SDL_memcpy(dest, bitmap->coverage + row * bitmap->width, bitmap->width);
+			}
+			SDL_MemoryBarrierRelease();
+			SDL_AtomicSet(&font->uploadsWritten, (int)(uploadIndex + 1));
+		}
+		result = true;
+	} else if (!font->atlasFull) {
+		font->atlasFull = true;
+		SDL_Log("text: glyph atlas is full");
+	}
+	return result;
+}
+
+// NOTE(khvorov) Called by whoever renders. Copies the coverage in as white with
+// the coverage in alpha, so that vertex colors tint it. Without an atlas the
+// uploads are only taken off the queue.
+void
+fontApplyUploads(Font* font, SDL_Texture* atlas) {
+	u32 uploadsWritten = (u32)SDL_AtomicGet(&font->uploadsWritten);
+	SDL_MemoryBarrierAcquire();
+	for (u32 uploadIndex = (u32)SDL_AtomicGet(&font->uploadsRead); uploadIndex != uploadsWritten; uploadIndex++) {
+		GlyphUpload* upload = font->uploads + (uploadIndex % GLYPH_UPLOADS_CAP);
+		if (atlas) {
+			i32 pixelCount = upload->texRect.w * upload->texRect.h;
+			for (i32 pixelIndex = 0; pixelIndex < pixelCount; pixelIndex++) {
+				u32 alpha = upload->coverage[pixelIndex];
+				font->uploadPixels[pixelIndex] = (alpha << 24) | 0x00FFFFFF;
+			}
+			SDL_UpdateTexture(atlas, &upload->texRect, font->uploadPixels, upload->texRect.w * (i32)sizeof(u32));
+		}
+		SDL_MemoryBarrierRelease();
+		SDL_AtomicSet(&font->uploadsRead, (int)(uploadIndex + 1));
+	}
+}
+
+// NOTE(khvorov) For an atlas texture made after glyphs were packed. Everything
+// packed so far is in the coverage, so the queue up to here is already in.
+// Goes a row at a time through the buffer uploads use, a row fits in it.
+void
+fontUploadAtlas(Font* font, SDL_Texture* atlas) {
+	u32 uploadsWritten = (u32)SDL_AtomicGet(&font->uploadsWritten);
+	SDL_MemoryBarrierAcquire();
+	for (i32 row = 0; row < GLYPH_ATLAS_DIM; row++) {
+		for (i32 column = 0; column < GLYPH_ATLAS_DIM; column++) {
+			u32 alpha = font->atlasCoverage[row * GLYPH_ATLAS_DIM + column];
+			font->uploadPixels[column] = (alpha << 24) | 0x00FFFFFF;
+		}
+		SDL_Rect rowRect = {.x = 0, .y = row, .w = GLYPH_ATLAS_DIM, .h = 1};
+		SDL_UpdateTexture(atlas, &rowRect, font->uploadPixels, GLYPH_ATLAS_DIM * (i32)sizeof(u32));
+	}
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&font->uploadsRead, (int)uploadsWritten);
+}
+
+void
+fontStoreGlyph(Font* font, GlyphBitmap* bitmap) {
+	Glyph* glyph = fontFindGlyphSlot(font, bitmap->codepoint);
+	SDL_Rect texRect;
+	if (bitmap->rasterized && fontAtlasUpload(font, bitmap, &texRect)) {
+		glyph->state = GlyphState_Ready;
+		glyph->texRect = texRect;
+		glyph->offsetX = bitmap->offsetX;
+		glyph->offsetY = bitmap->offsetY;
+		glyph->advance = bitmap->advance;
+	} else {
+		glyph->state = GlyphState_Missing;
+	}
+}
+
+// NOTE(khvorov) Leaves the glyph empty if a queue is full so that it gets
+// asked for again the next time it's drawn
+void
+fontRequestGlyph(Font* font, u32 codepoint) {
+	Glyph* glyph = fontFindGlyphSlot(font, codepoint);
+	if (glyph->state == GlyphState_Empty && font->glyphCount < GLYPH_TABLE_CAP - 1) {
+		if (font->workerCount == 0) {
+			if (fontCanUpload(font)) {
+				glyph->codepoint = codepoint;
+				font->glyphCount += 1;
+				GlyphBitmap* bitmap = font->results;
+				glyphRasterize(font->ftFace, codepoint, bitmap);
+				fontStoreGlyph(font, bitmap);
+			}
+		} else if (font->inFlight < GLYPH_QUEUE_CAP) {
+			glyph->codepoint = codepoint;
+			glyph->state = GlyphState_Pending;
+			font->glyphCount += 1;
+			font->inFlight += 1;
+			font->requests[font->requestsWritten % GLYPH_QUEUE_CAP] = codepoint;
+			font->requestsWritten += 1;
+			SDL_SemPost(font->requestSem);
+		}
+	}
+}
+
+// NOTE(khvorov) Packs whatever the workers have finished without waiting for
+// the rest, as long as there's room to upload it. Returns true if anything arrived.
+b32
+fontProcessResults(Font* font) {
+	b32 result = false;
+	while (font->inFlight > 0 && fontCanUpload(font)) {
+		GlyphBitmap* bitmap = font->results + (font->resultsRead % GLYPH_QUEUE_CAP);
+		if ((u32)SDL_AtomicGet(&bitmap->sequence) != font->resultsRead + 1) {
+			break;
+		}
+		SDL_MemoryBarrierAcquire();
+		fontStoreGlyph(font, bitmap);
+		font->resultsRead += 1;
+		font->inFlight -= 1;
+		result = true;
+	}
+	return result;
+}
+
+Glyph*
+fontGetGlyph(Font* font, u32 codepoint) {
+	Glyph* result = 0;
+	if (font->ftFace) {
+		fontRequestGlyph(font, codepoint);
+		Glyph* glyph = fontFindGlyphSlot(font, codepoint);
+		if (glyph->state != GlyphState_Empty) {
+			result = glyph;
+		}
+	}
+	return result;
+}
+
+void
+clearHalfTransitionCounts(Input* input) {
+	for (i32 keyIndex = 0; keyIndex < InputKeyID_Count; keyIndex += 1) {
+		InputKey* key = input->keys + keyIndex;
+		key->halfTransitionCount = 0;
+	}
+	input->scrollY = 0;
+	input->textLen = 0;
+	input->eventTime = 0;
+}
+
+void
+recordKey(Input* input, InputKeyID keyID, b32 down) {
+	InputKey* key = input->keys + keyID;
+	key->halfTransitionCount += 1;
+	key->endedDown = down;
+}
+
+b32
+wasPressed(Input* input, InputKeyID keyID) {
+	InputKey* key = input->keys + keyID;
+	b32 result = key->halfTransitionCount > 1 || (key->halfTransitionCount == 1 && key->endedDown);
+	return result;
+}
+
+b32
+wasUnpressed(Input* input, InputKeyID keyID) {
+	InputKey* key = input->keys + keyID;
+	b32 result = key->halfTransitionCount > 1 || (key->halfTransitionCount == 1 && !key->endedDown);
+	return result;
+}
+
+void
+uiCompactZKeys(UIWindows* windows) {
+	i32 zKey = 0;
+	for (UIWindowID winID = windows->back; winID >= 0; winID = windows->inFront[winID]) {
+		windows->zKeys[winID] = zKey++;
+	}
+	windows->zBottom = 0;
+	windows->zTop = zKey - 1;
+}
+
+void
+uiUnlinkWindowOrder(UIWindows* windows, UIWindowID winID) {
+	UIWindowID inFront = windows->inFront[winID];
+	UIWindowID behind = windows->behind[winID];
+
+	if (inFront >= 0) {
+		windows->behind[inFront] = behind;
+	} else {
+		windows->front = behind;
+	}
+
+	if (behind >= 0) {
+		windows->inFront[behind] = inFront;
+	} else {
+		windows->back = inFront;
+	}
+
+	windows->inFront[winID] = UIWindowID_Invalid;
+	windows->behind[winID] = UIWindowID_Invalid;
+}
+
+void
+uiLinkWindowAtFront(UIWindows* windows, UIWindowID winID) {
+	windows->inFront[winID] = UIWindowID_Invalid;
+	windows->behind[winID] = windows->front;
+	if (windows->front >= 0) {
+		windows->inFront[windows->front] = winID;
+	} else {
+		windows->back = winID;
+	}
+	windows->front = winID;
+
+	if (windows->zTop == INT32_MAX) {
+		uiCompactZKeys(windows);
+	}
+	windows->zKeys[winID] = ++windows->zTop;
+}
+
+void
+uiLinkWindowAtBack(UIWindows* windows, UIWindowID winID) {
+	windows->behind[winID] = UIWindowID_Invalid;
+	windows->inFront[winID] = windows->back;
+	if (windows->back >= 0) {
+		windows->behind[windows->back] = winID;
+	} else {
+		windows->front = winID;
+	}
+	windows->back = winID;
+
+	if (windows->zBottom == INT32_MIN) {
+		uiCompactZKeys(windows);
+	}
+	windows->zKeys[winID] = --windows->zBottom;
+}
+
+void
+uiMoveWindowToFront(UI* ui, UIWindowID winID) {
+	UIWindows* windows = &ui->windows;
+	if (windows->front != winID) {
+		uiUnlinkWindowOrder(windows, winID);
+		uiLinkWindowAtFront(windows, winID);
+	}
+}
+
+void
+uiMoveWindowToBack(UI* ui, UIWindowID winID) {
+	UIWindows* windows = &ui->windows;
+	if (windows->back != winID) {
+		uiUnlinkWindowOrder(windows, winID);
+		uiLinkWindowAtBack(windows, winID);
+	}
+}
+
+SDL_Rect
+uiGetWindowRect(UI* ui, UIWindowID winID) {
+	SDL_Rect winRect = {.x = 0, .y = 0, .w = ui->width, .h = ui->height};
+	if (winID >= 0) {
+		winRect = ui->windows.layoutRects[winID];
+	}
+	return winRect;
+}
+
+SDL_Rect
+uiGetWindowTopbarRect(UI* ui, UIWindowID winID) {
+	SDL_Rect topBarRect = ui->windows.topbarRects[winID];
+	return topBarRect;
+}
+
+SDL_Rect
+uiGetWindowContentRect(UI* ui, UIWindowID winID) {
+	SDL_Rect contentRect = ui->windows.contentRects[winID];
+	return contentRect;
+}
+
+SDL_Rect
+uiTopbarRectFromWindowRect(UI* ui, SDL_Rect winRect) {
+	SDL_Rect topBarRect = rectShrink(winRect, ui->windowBorderThickness);
+	topBarRect.h = ui->windowTopBarHeight;
+	return topBarRect;
+}
+
+SDL_Rect
+uiContentRectFromWindowRect(UI* ui, SDL_Rect winRect) {
+	SDL_Rect contentRect = rectShrink(winRect, ui->windowBorderThickness);
+	contentRect.h -= ui->windowTopBarHeight;
+	contentRect.y += ui->windowTopBarHeight;
+	return contentRect;
+}
+
+void
+uiDamageRect(UI* ui, SDL_Rect rect) {
+	SDL_Rect screenRect = {.x = 0, .y = 0, .w = ui->width, .h = ui->height};
+	damageAdd(&ui->damage, rectIntersect(rect, screenRect));
+}
+
+// NOTE(khvorov) For changes to what a window looks like as opposed to where it
+// is. Its cached pixels are redrawn where they changed. Torn off windows are
+// not on the main screen so it stays as it is.
+void
+uiDamageWindow(UI* ui, UIWindowID winID, SDL_Rect rect) {
+	SDL_Rect winRect = uiGetWindowRect(ui, winID);
+	SDL_Rect changed = rectIntersect(rect, winRect);
+	changed.x -= winRect.x;
+	changed.y -= winRect.y;
+	SDL_Rect* dirty = ui->windows.dirtyRects + winID;
+	*dirty = rectArea(*dirty) > 0 ? rectUnion(*dirty, changed) : changed;
+	if (!(ui->windows.flags[winID] & UIWindowFlag_Detached)) {
+		uiDamageRect(ui, rect);
+	}
+}
+
+void
+uiDamageWindowsUnder(UI* ui, SDL_Rect rect) {
+	for (UIWindowID winID = ui->windows.front; winID >= 0; winID = ui->windows.behind[winID]) {
+		if (rectsIntersect(rect, uiGetWindowRect(ui, winID))) {
+			uiDamageWindow(ui, winID, rect);
+		}
+	}
+}
+
+void
+uiDamageEverything(UI* ui) {
+	damageClear(&ui->damage);
+	SDL_Rect screenRect = {.x = 0, .y = 0, .w = ui->width, .h = ui->height};
+	uiDamageRect(ui, screenRect);
+}
+
+void
+uiWindowsGrow(UIWindows* windows, Arena* arena) {
+	i32 newCap = windows->cap == 0 ? 64 : windows->cap * 2;
+	windows->rects = arenaGrowArray(arena, windows->rects, windows->cap, newCap, sizeof(*windows->rects));
+	windows->layoutRects = arenaGrowArray(arena, windows->layoutRects, windows->cap, newCap, sizeof(*windows->layoutRects));
+	windows->flags = arenaGrowArray(arena, windows->flags, windows->cap, newCap, sizeof(*windows->flags));
+	windows->dockParents = arenaGrowArray(arena, windows->dockParents, windows->cap, newCap, sizeof(*windows->dockParents));
+	windows->dockPositions = arenaGrowArray(arena, windows->dockPositions, windows->cap, newCap, sizeof(*windows->dockPositions));
+	windows->dockFirstChildren = arenaGrowArray(arena, windows->dockFirstChildren, windows->cap, newCap, sizeof(*windows->dockFirstChildren));
+	windows->dockNextSiblings = arenaGrowArray(arena, windows->dockNextSiblings, windows->cap, newCap, sizeof(*windows->dockNextSiblings));
+	windows->dockPrevSiblings = arenaGrowArray(arena, windows->dockPrevSiblings, windows->cap, newCap, sizeof(*windows->dockPrevSiblings));
+	windows->dockAreas = arenaGrowArray(arena, windows->dockAreas, windows->cap, newCap, sizeof(*windows->dockAreas));
+	windows->dockSpaces = arenaGrowArray(arena, windows->dockSpaces, windows->cap, newCap, sizeof(*windows->dockSpaces));
+	windows->dockFractions = arenaGrowArray(arena, windows->dockFractions, windows->cap, newCap, sizeof(*windows->dockFractions));
+	windows->inFront = arenaGrowArray(arena, windows->inFront, windows->cap, newCap, sizeof(*windows->inFront));
+	windows->behind = arenaGrowArray(arena, windows->behind, windows->cap, newCap, sizeof(*windows->behind));
+	windows->zKeys = arenaGrowArray(arena, windows->zKeys, windows->cap, newCap, sizeof(*windows->zKeys));
+	windows->topbarRects = arenaGrowArray(arena, windows->topbarRects, windows->cap, newCap, sizeof(*windows->topbarRects));
+	windows->contentRects = arenaGrowArray(arena, windows->contentRects, windows->cap, newCap, sizeof(*windows->contentRects));
+	windows->tabRects = arenaGrowArray(arena, windows->tabRects, windows->cap, newCap, sizeof(*windows->tabRects));
+	windows->colors = arenaGrowArray(arena, windows->colors, windows->cap, newCap, sizeof(*windows->colors));
+	windows->titles = arenaGrowArray(arena, windows->titles, windows->cap, newCap, sizeof(*windows->titles));
+	windows->contents = arenaGrowArray(arena, windows->contents, windows->cap, newCap, sizeof(*windows->contents));
+	windows->lists = arenaGrowArray(arena, windows->lists, windows->cap, newCap, sizeof(*windows->lists));
+	windows->dirtyRects = arenaGrowArray(arena, windows->dirtyRects, windows->cap, newCap, sizeof(*windows->dirtyRects));
+	windows->spatialRects = arenaGrowArray(arena, windows->spatialRects, windows->cap, newCap, sizeof(*windows->spatialRects));
+	windows->splitterRects = arenaGrowArray(arena, windows->splitterRects, windows->cap, newCap, sizeof(*windows->splitterRects));
+	windows->dragOffsets = arenaGrowArray(arena, windows->dragOffsets, windows->cap, newCap, sizeof(*windows->dragOffsets));
+	windows->generations = arenaGrowArray(arena, windows->generations, windows->cap, newCap, sizeof(*windows->generations));
+	windows->nextFree = arenaGrowArray(arena, windows->nextFree, windows->cap, newCap, sizeof(*windows->nextFree));
+	windows->layoutDirtyList = arenaGrowArray(arena, windows->layoutDirtyList, windows->cap, newCap, sizeof(*windows->layoutDirtyList));
+	windows->cap = newCap;
+}
+
+void
+uiSpatialUpdateWindow(UI* ui, UIWindowID winID) {
+	UIWindows* windows = &ui->windows;
+	SDL_Rect newRect = {0};
+	if ((windows->flags[winID] & UIWindowFlag_Alive) && !(windows->flags[winID] & UIWindowFlag_Detached)) {
+		newRect = uiGetWindowRect(ui, winID);
+	}
+
+	SDL_Rect oldRect = windows->spatialRects[winID];
+	if (!rectsEqual(oldRect, newRect)) {
+		SpatialItem item = {.kind = SpatialItemKind_Window, .id = winID};
+		spatialRemove(&ui->spatial, item, oldRect);
+		spatialInsert(&ui->spatial, item, newRect);
+		windows->spatialRects[winID] = newRect;
+	}
+}
+
+void
+uiSpatialUpdateSplitter(UI* ui, UIWindowID winID, SDL_Rect newRect) {
+	UIWindows* windows = &ui->windows;
+	SDL_Rect oldRect = windows->splitterRects[winID];
+	if (!rectsEqual(oldRect, newRect)) {
+		SpatialItem item = {.kind = SpatialItemKind_Splitter, .id = winID};
+		spatialRemove(&ui->spatial, item, oldRect);
+		spatialInsert(&ui->spatial, item, newRect);
+		windows->splitterRects[winID] = newRect;
+	}
+}
+
+void
+uiSpatialRebuild(UI* ui) {
+	UIWindows* windows = &ui->windows;
+	spatialReset(&ui->spatial, ui->width, ui->height);
+
+	for (UIWindowID winID = 0; winID < windows->slotCount; winID++) {
+		SDL_Rect rect = {0};
+		if ((windows->flags[winID] & UIWindowFlag_Alive) && !(windows->flags[winID] & UIWindowFlag_Detached)) {
+			rect = uiGetWindowRect(ui, winID);
+			SpatialItem item = {.kind = SpatialItemKind_Window, .id = winID};
+			spatialInsert(&ui->spatial, item, rect);
+		}
+		windows->spatialRects[winID] = rect;
+
+		SDL_Rect splitterRect = {0};
+		if (windows->flags[winID] & UIWindowFlag_Alive) {
+			splitterRect = windows->splitterRects[winID];
+			SpatialItem item = {.kind = SpatialItemKind_Splitter, .id = winID};
+			spatialInsert(&ui->spatial, item, splitterRect);
+		}
+		windows->splitterRects[winID] = splitterRect;
+	}
+}
+
+UIWindowID
+uiGetTopmostWindowAt(UI* ui, i32 pointX, i32 pointY) {
+	UIWindows* windows = &ui->windows;
+	UIWindowID result = UIWindowID_Invalid;
+	SpatialCell* cell = spatialGetCell(&ui->spatial, pointX, pointY);
+	if (cell && cell->count > SPATIAL_CELL_CROWDED) {
+		for (UIWindowID winID = windows->front; winID >= 0; winID = windows->behind[winID]) {
+			if (pointInRect(pointX, pointY, windows->spatialRects[winID])) {
+				result = winID;
+				break;
+			}
+		}
+	} else if (cell) {
+		i32 bestZKey = INT32_MIN;
+		for (i32 itemIndex = 0; itemIndex < cell->count; itemIndex++) {
+			SpatialItem item = cell->items[itemIndex];
+			if (item.kind == SpatialItemKind_Window) {
+				i32 zKey = windows->zKeys[item.id];
+				if ((result == UIWindowID_Invalid || zKey > bestZKey) && pointInRect(pointX, pointY, windows->spatialRects[item.id])) {
+					bestZKey = zKey;
+					result = item.id;
+				}
+			}
+		}
+	}
+	return result;
+}
+
+// NOTE(khvorov) Floating windows in front of a splitter take the clicks
+UIWindowID
+uiGetSplitterAt(UI* ui, i32 pointX, i32 pointY) {
+	UIWindows* windows = &ui->windows;
+	UIWindowID result = UIWindowID_Invalid;
+	SpatialCell* cell = spatialGetCell(&ui->spatial, pointX, pointY);
+	if (cell) {
+		for (i32 itemIndex = 0; itemIndex < cell->count; itemIndex++) {
+			SpatialItem item = cell->items[itemIndex];
+			if (item.kind == SpatialItemKind_Splitter && pointInRect(pointX, pointY, windows->splitterRects[item.id])) {
+				result = item.id;
+				break;
+			}
+		}
+	}
+	if (result >= 0) {
+		UIWindowID topmostID = uiGetTopmostWindowAt(ui, pointX, pointY);
+		if (topmostID >= 0 && !(windows->flags[topmostID] & UIWindowFlag_Docked)) {
+			result = UIWindowID_Invalid;
+		}
+	}
+	return result;
+}
+
+i32
+uiGetDockTargetAt(UI* ui, i32 pointX, i32 pointY) {
+	i32 result = -1;
+	for (i32 targetIndex = 0; targetIndex < ui->dockTargetCount; targetIndex++) {
+		if (pointInRect(pointX, pointY, ui->dockTargets[targetIndex].rect)) {
+			result = targetIndex;
+		}
+	}
+	return result;
+}
+
+PickID
+pickEncode(UIWindowID winID, UIWindowPart part, i32 dockTarget) {
+	PickID windowBits = winID >= 0 ? (PickID)(winID + 1) : 0;
+	PickID dockBits = dockTarget >= 0 ? (PickID)dockTarget : UI_DOCK_TARGETS_MAX;
+	PickID result = (windowBits << (PICK_PART_BITS + PICK_DOCK_BITS)) | (dockBits << PICK_PART_BITS) | (PickID)part;
+	return result;
+}
+
+UIPick
+pickDecode(PickID id) {
+	PickID windowBits = id >> (PICK_PART_BITS + PICK_DOCK_BITS);
+	PickID dockBits = (id >> PICK_PART_BITS) & ((1 << PICK_DOCK_BITS) - 1);
+	UIPick result = {
+		.window = windowBits > 0 ? (UIWindowID)windowBits - 1 : UIWindowID_Invalid,
+		.part = (UIWindowPart)(id & ((1 << PICK_PART_BITS) - 1)),
+		.dockTarget = dockBits < UI_DOCK_TARGETS_MAX ? (i32)dockBits : -1,
+	};
+	return result;
+}
+
+void
+pickResize(PickBuffer* pick, i32 width, i32 height) {
+	arenaReset(&pick->arena);
+	pick->width = width;
+	pick->height = height;
+	pick->ids = arenaAlloc(&pick->arena, (size_t)width * (size_t)height * sizeof(PickID));
+	SDL_memset(pick->ids, 0, (size_t)width * (size_t)height * sizeof(PickID));
+}
+
+void
+pickFill(PickBuffer* pick, SDL_Rect rect, PickID id) {
+	SDL_Rect bufferRect = {.x = 0, .y = 0, .w = pick->width, .h = pick->height};
+	rect = rectIntersect(rect, bufferRect);
+	for (i32 row = rect.y; row < rect.y + rect.h; row++) {
+		SDL_memset4(pick->ids + (size_t)row * (size_t)pick->width + rect.x, id, (size_t)rect.w);
+	}
+}
+
+// NOTE(khvorov) Dock targets are drawn over whatever is there but the window
+// under them still gets the clicks
+void
+pickSetDockTarget(PickBuffer* pick, SDL_Rect rect, i32 dockTarget) {
+	SDL_Rect bufferRect = {.x = 0, .y = 0, .w = pick->width, .h = pick->height};
+	rect = rectIntersect(rect, bufferRect);
+	PickID dockMask = ((1 << PICK_DOCK_BITS) - 1) << PICK_PART_BITS;
+	PickID dockBits = (PickID)dockTarget << PICK_PART_BITS;
+	for (i32 row = rect.y; row < rect.y + rect.h; row++) {
+		PickID* ids = pick->ids + (size_t)row * (size_t)pick->width + rect.x;
+		for (i32 col = 0; col < rect.w; col++) {
+			ids[col] = (ids[col] & ~dockMask) | dockBits;
+		}
+	}
+}
+
+void
+uiPickEnable(UI* ui) {
+	arenaInit(&ui->pick.arena, "pick", (size_t)256 * 1024 * 1024);
+	ui->pick.enabled = true;
+	pickResize(&ui->pick, ui->width, ui->height);
+}
+
+// NOTE(khvorov) The draw pass calls these for the parts of the screen it
+// redraws, in the order it draws them
+void
+uiPickPaintBackground(UI* ui, SDL_Rect rect) {
+	pickFill(&ui->pick, rect, pickEncode(UIWindowID_Invalid, UIWindowPart_None, -1));
+}
+
+void
+uiPickPaintWindow(UI* ui, UIWindowID winID, SDL_Rect rect) {
+	PickBuffer* pick = &ui->pick;
+	SDL_Rect winRect = uiGetWindowRect(ui, winID);
+	SDL_Rect clip = rectIntersect(rect, winRect);
+
+	// NOTE(khvorov) Every pixel is written once, the buffer is as big as the screen
+	SDL_Rect borderPieces[4];
+	i32 borderPieceCount = rectSubtract(clip, rectShrink(winRect, ui->windowBorderThickness), borderPieces);
+	for (i32 pieceIndex = 0; pieceIndex < borderPieceCount; pieceIndex++) {
+		pickFill(pick, borderPieces[pieceIndex], pickEncode(winID, UIWindowPart_Border, -1));
+	}
+	pickFill(pick, rectIntersect(clip, uiGetWindowTopbarRect(ui, winID)), pickEncode(winID, UIWindowPart_Topbar, -1));
+	pickFill(pick, rectIntersect(clip, uiGetWindowContentRect(ui, winID)), pickEncode(winID, UIWindowPart_Content, -1));
+}
+
+void
+uiPickPaintDockTargets(UI* ui, SDL_Rect rect) {
+	for (i32 targetIndex = 0; targetIndex < ui->dockTargetCount; targetIndex++) {
+		pickSetDockTarget(&ui->pick, rectIntersect(rect, ui->dockTargets[targetIndex].rect), targetIndex);
+	}
+}
+
+UIWindowPart
+uiGetWindowPartAt(UI* ui, UIWindowID winID, i32 pointX, i32 pointY) {
+	UIWindowPart result = UIWindowPart_Border;
+	if (pointInRect(pointX, pointY, uiGetWindowTopbarRect(ui, winID))) {
+		result = UIWindowPart_Topbar;
+	} else if (pointInRect(pointX, pointY, uiGetWindowContentRect(ui, winID))) {
+		result = UIWindowPart_Content;
+	}
+	return result;
+}
+
+// NOTE(khvorov) Damaged pixels haven't been drawn yet so what the buffer says
+// about them is stale. The spatial grid answers for those. A torn off window
+// with the cursor in it is in front of everything in the main window.
+UIPick
+uiPickAt(UI* ui, i32 pointX, i32 pointY) {
+	UIPick result = {.window = UIWindowID_Invalid, .part = UIWindowPart_None, .dockTarget = -1};
+	SDL_Rect point = {.x = pointX, .y = pointY, .w = 1, .h = 1};
+	b32 inBuffer = pointX >= 0 && pointX < ui->pick.width && pointY >= 0 && pointY < ui->pick.height;
+	UIWindowID detachedID = ui->cursorDetachedWindow;
+	if (detachedID >= 0 && pointInRect(pointX, pointY, uiGetWindowRect(ui, detachedID))) {
+		result.window = detachedID;
+		result.part = uiGetWindowPartAt(ui, detachedID, pointX, pointY);
+		result.dockTarget = uiGetDockTargetAt(ui, pointX, pointY);
+	} else if (ui->pick.enabled && inBuffer && !damageIntersects(&ui->damage, point)) {
+		result = pickDecode(ui->pick.ids[(size_t)pointY * (size_t)ui->pick.width + pointX]);
+	} else {
+		result.window = uiGetTopmostWindowAt(ui, pointX, pointY);
+		result.dockTarget = uiGetDockTargetAt(ui, pointX, pointY);
+		if (result.window >= 0) {
+			result.part = uiGetWindowPartAt(ui, result.window, pointX, pointY);
+		}
+	}
+	return result;
+}
+
+void
+uiInvalidateLayout(UI* ui, UIWindowID winID) {
+	UIWindows* windows = &ui->windows;
+	if (winID == UIWindowID_Root) {
+		ui->rootLayoutDirty = true;
+	} else if (!(windows->flags[winID] & UIWindowFlag_LayoutDirty)) {
+		windows->flags[winID] |= UIWindowFlag_LayoutDirty;
+		windows->layoutDirtyList[windows->layoutDirtyCount++] = winID;
+	}
+}
+
+UIWindowID
+uiGetFirstDockChild(UI* ui, UIWindowID parentID) {
+	UIWindowID result = parentID == UIWindowID_Root ? ui->rootDockFirstChild : ui->windows.dockFirstChildren[parentID];
+	return result;
+}
+
+// NOTE(khvorov) Windows docked to the center of another one are its tabs. The
+// owner is the window they're docked to, which can't be a tab itself. The
+// root's tabs have no owner window.
+UIWindowID
+uiGetTabOwner(UI* ui, UIWindowID winID) {
+	UIWindows* windows = &ui->windows;
+	UIWindowID result = winID;
+	if ((windows->flags[winID] & UIWindowFlag_Docked) && windows->dockPositions[winID] == DockPos_Center) {
+		result = windows->dockParents[winID];
+	}
+	return result;
+}
+
+// NOTE(khvorov) Cuts the slice a window docked to a side takes out of space,
+// what's left goes into rest
+SDL_Rect
+uiDockCarve(SDL_Rect space, DockPos pos, f32 fraction, SDL_Rect* rest) {
+	SDL_Rect slice = space;
+	*rest = space;
+	i32 sliceW = (i32)((f32)space.w * fraction + 0.5f);
+	i32 sliceH = (i32)((f32)space.h * fraction + 0.5f);
+	switch (pos) {
+	case DockPos_Left: {slice.w = sliceW; rest->x += sliceW; rest->w -= sliceW;} break;
+	case DockPos_Right: {slice.x += space.w - sliceW; slice.w = sliceW; rest->w -= sliceW;} break;
+	case DockPos_Top: {slice.h = sliceH; rest->y += sliceH; rest->h -= sliceH;} break;
+	case DockPos_Bottom: {slice.y += space.h - sliceH; slice.h = sliceH; rest->h -= sliceH;} break;
+	case DockPos_Center: case DockPos_Count: break;
+	}
+	return slice;
+}
+
+// NOTE(khvorov) Covers the borders on both sides of the edge between a side
+// docked window and what its parent has left
+SDL_Rect
+uiGetSplitterRect(UI* ui, SDL_Rect slice, DockPos pos) {
+	i32 border = ui->windowBorderThickness;
+	SDL_Rect result = slice;
+	switch (pos) {
+	case DockPos_Left: {result.x = slice.x + slice.w - border; result.w = 2 * border;} break;
+	case DockPos_Right: {result.x = slice.x - border; result.w = 2 * border;} break;
+	case DockPos_Top: {result.y = slice.y + slice.h - border; result.h = 2 * border;} break;
+	case DockPos_Bottom: {result.y = slice.y - border; result.h = 2 * border;} break;
+	case DockPos_Center: case DockPos_Count: {result = (SDL_Rect) {0};} break;
+	}
+	return result;
+}
+
+SDL_Rect
+uiGetTabRect(SDL_Rect topbarRect, i32 tabIndex, i32 tabCount) {
+	SDL_Rect result = topbarRect;
+	result.x = topbarRect.x + topbarRect.w * tabIndex / tabCount;
+	result.w = topbarRect.x + topbarRect.w * (tabIndex + 1) / tabCount - result.x;
+	return result;
+}
+
+void uiLayoutSubtree(UI* ui, UIWindowID winID, SDL_Rect area, i32 tabIndex, i32 tabCount);
+
+// NOTE(khvorov) Side docked windows take their slices out of area in the order
+// they were docked. What's left is shared by the owner and its tabs and is
+// returned. Children whose area and tab didn't change are skipped along with
+// their subtrees, which is what keeps a splitter drag from touching anything
+// but the windows it resizes.
+SDL_Rect
+uiLayoutChildren(UI* ui, UIWindowID ownerID, SDL_Rect area, i32* tabCount) {
+	UIWindows* windows = &ui->windows;
+	UIWindowID firstChildID = uiGetFirstDockChild(ui, ownerID);
+	i32 firstTabIndex = ownerID == UIWindowID_Root ? 0 : 1;
+
+	SDL_Rect rest = area;
+	*tabCount = firstTabIndex;
+	for (UIWindowID childID = firstChildID; childID >= 0; childID = windows->dockNextSiblings[childID]) {
+		DockPos pos = windows->dockPositions[childID];
+		if (pos == DockPos_Center) {
+			*tabCount += 1;
+		} else {
+			windows->dockSpaces[childID] = rest;
+			SDL_Rect slice = uiDockCarve(rest, pos, windows->dockFractions[childID], &rest);
+			if ((windows->flags[childID] & UIWindowFlag_LayoutDirty) || !rectsEqual(windows->dockAreas[childID], slice)) {
+				uiLayoutSubtree(ui, childID, slice, 0, 1);
+			}
+		}
+	}
+
+	SDL_Rect topbarRect = uiTopbarRectFromWindowRect(ui, rest);
+	i32 tabIndex = firstTabIndex;
+	for (UIWindowID childID = firstChildID; childID >= 0; childID = windows->dockNextSiblings[childID]) {
+		if (windows->dockPositions[childID] == DockPos_Center) {
+			SDL_Rect tabRect = uiGetTabRect(topbarRect, tabIndex, *tabCount);
+			b32 dirty = (windows->flags[childID] & UIWindowFlag_LayoutDirty) != 0;
+			if (dirty || !rectsEqual(windows->dockAreas[childID], rest) || !rectsEqual(windows->tabRects[childID], tabRect)) {
+				uiLayoutSubtree(ui, childID, rest, tabIndex, *tabCount);
+			}
+			tabIndex += 1;
+		}
+	}
+
+	return rest;
+}
+
+// NOTE(khvorov) area is what the dock parent gave the window or its own rect
+// if it's floating. Tabs get their place in the topbar from their owner, the
+// rest of the windows are first in their own.
+void
+uiLayoutSubtree(UI* ui, UIWindowID winID, SDL_Rect area, i32 tabIndex, i32 tabCount) {
+	UIWindows* windows = &ui->windows;
+	windows->dockAreas[winID] = area;
+
+	i32 ownTabCount = 1;
+	SDL_Rect newRect = uiLayoutChildren(ui, winID, area, &ownTabCount);
+	if (uiGetTabOwner(ui, winID) == winID) {
+		tabIndex = 0;
+		tabCount = ownTabCount;
+	}
+
+	SDL_Rect newTopbarRect = uiTopbarRectFromWindowRect(ui, newRect);
+	SDL_Rect newTabRect = uiGetTabRect(newTopbarRect, tabIndex, tabCount);
+	SDL_Rect oldRect = windows->layoutRects[winID];
+	if (!rectsEqual(oldRect, newRect)) {
+		windows->layoutRects[winID] = newRect;
+		windows->topbarRects[winID] = newTopbarRect;
+		windows->contentRects[winID] = uiContentRectFromWindowRect(ui, newRect);
+		if (!(windows->flags[winID] & UIWindowFlag_Detached)) {
+			uiDamageRect(ui, oldRect);
+			uiDamageRect(ui, newRect);
+		}
+		uiSpatialUpdateWindow(ui, winID);
+	} else if (!rectsEqual(windows->tabRects[winID], newTabRect)) {
+		uiDamageWindow(ui, winID, newTopbarRect);
+	}
+	windows->tabRects[winID] = newTabRect;
+
+	SDL_Rect splitterRect = {0};
+	if (windows->flags[winID] & UIWindowFlag_Docked) {
+		splitterRect = uiGetSplitterRect(ui, area, windows->dockPositions[winID]);
+	}
+	uiSpatialUpdateSplitter(ui, winID, splitterRect);
+
+	windows->flags[winID] &= ~UIWindowFlag_LayoutDirty;
+}
+
+// NOTE(khvorov) Tabs are placed by their owner so it's laid out in their place
+void
+uiLayoutFrom(UI* ui, UIWindowID winID) {
+	UIWindows* windows = &ui->windows;
+	UIWindowID ownerID = winID == UIWindowID_Root ? UIWindowID_Root : uiGetTabOwner(ui, winID);
+	if (ownerID == UIWindowID_Root) {
+		SDL_Rect screenRect = {.x = 0, .y = 0, .w = ui->width, .h = ui->height};
+		i32 tabCount = 0;
+		uiLayoutChildren(ui, UIWindowID_Root, screenRect, &tabCount);
+	} else {
+		SDL_Rect area = windows->rects[ownerID];
+		if (windows->flags[ownerID] & UIWindowFlag_Docked) {
+			area = windows->dockAreas[ownerID];
+		}
+		uiLayoutSubtree(ui, ownerID, area, 0, 1);
+	}
+}
+
+// NOTE(khvorov) Only the subtrees under invalidated windows are laid out again.
+// If both a window and one of its ancestors are dirty, the ancestor's pass
+// covers the window. Changes to how a parent is split have to invalidate the
+// parent, children only know their own area.
+void
+uiLayout(UI* ui) {
+	UIWindows* windows = &ui->windows;
+
+	if (ui->rootLayoutDirty) {
+		uiLayoutFrom(ui, UIWindowID_Root);
+		ui->rootLayoutDirty = false;
+	}
+
+	for (i32 dirtyIndex = 0; dirtyIndex < windows->layoutDirtyCount; dirtyIndex++) {
+		UIWindowID winID = windows->layoutDirtyList[dirtyIndex];
+		if (windows->flags[winID] & UIWindowFlag_LayoutDirty) {
+			UIWindowID topDirtyID = winID;
+			for (UIWindowID parentID = windows->dockParents[winID]; parentID >= 0; parentID = windows->dockParents[parentID]) {
+				if (windows->flags[parentID] & UIWindowFlag_LayoutDirty) {
+					topDirtyID = parentID;
+				}
+			}
+			uiLayoutFrom(ui, topDirtyID);
+		}
+	}
+	windows->layoutDirtyCount = 0;
+}
+
+// NOTE(khvorov) The window goes after its siblings so that it's carved out of
+// whatever the parent has left now. Windows with children of their own can't
+// be tabs and neither can tabs have children.
+void
+uiDock(UI* ui, UIWindowID winID, UIWindowID parentID, DockPos pos) {
+	UIWindows* windows = &ui->windows;
+	SDL_assert(!(windows->flags[winID] & UIWindowFlag_Docked));
+	SDL_assert(pos != DockPos_Center || windows->dockFirstChildren[winID] < 0);
+	SDL_assert(parentID == UIWindowID_Root || uiGetTabOwner(ui, parentID) == parentID);
+
+	UIWindowID lastChildID = UIWindowID_Invalid;
+	for (UIWindowID childID = uiGetFirstDockChild(ui, parentID); childID >= 0; childID = windows->dockNextSiblings[childID]) {
+		lastChildID = childID;
+	}
+
+	windows->dockPrevSiblings[winID] = lastChildID;
+	windows->dockNextSiblings[winID] = UIWindowID_Invalid;
+	if (lastChildID >= 0) {
+		windows->dockNextSiblings[lastChildID] = winID;
+	} else if (parentID == UIWindowID_Root) {
+		ui->rootDockFirstChild = winID;
+	} else {
+		windows->dockFirstChildren[parentID] = winID;
+	}
+
+	windows->flags[winID] |= UIWindowFlag_Docked;
+	windows->dockParents[winID] = parentID;
+	windows->dockPositions[winID] = pos;
+	windows->dockFractions[winID] = 0.5f;
+	uiInvalidateLayout(ui, winID);
+	uiInvalidateLayout(ui, parentID);
+}
+
+// NOTE(khvorov) The window floats where its dock area was so that it keeps
+// the size of everything docked into it
+void
+uiUndock(UI* ui, UIWindowID winID) {
+	UIWindows* windows = &ui->windows;
+	if (windows->flags[winID] & UIWindowFlag_Docked) {
+		UIWindowID parentID = windows->dockParents[winID];
+		UIWindowID prevID = windows->dockPrevSiblings[winID];
+		UIWindowID nextID = windows->dockNextSiblings[winID];
+
+		if (prevID >= 0) {
+			windows->dockNextSiblings[prevID] = nextID;
+		} else if (parentID == UIWindowID_Root) {
+			ui->rootDockFirstChild = nextID;
+		} else {
+			windows->dockFirstChildren[parentID] = nextID;
+		}
+
+		if (nextID >= 0) {
+			windows->dockPrevSiblings[nextID] = prevID;
+		}
+
+		windows->rects[winID] = windows->dockAreas[winID];
+		windows->flags[winID] &= ~UIWindowFlag_Docked;
+		windows->dockParents[winID] = UIWindowID_Invalid;
+		windows->dockPositions[winID] = DockPos_Center;
+		windows->dockPrevSiblings[winID] = UIWindowID_Invalid;
+		windows->dockNextSiblings[winID] = UIWindowID_Invalid;
+		uiSpatialUpdateSplitter(ui, winID, (SDL_Rect) {0});
+		uiInvalidateLayout(ui, winID);
+		uiInvalidateLayout(ui, parentID);
+	}
+}
+
+void
+uiSetWindowRect(UI* ui, UIWindowID winID, SDL_Rect rect) {
+	UIWindows* windows = &ui->windows;
+	if (!rectsEqual(windows->rects[winID], rect)) {
+		windows->rects[winID] = rect;
+		if (!(windows->flags[winID] & UIWindowFlag_Docked)) {
+			uiInvalidateLayout(ui, winID);
+		}
+	}
+}
+
+void
+uiForgetDetachedWindow(UI* ui, UIWindowID winID) {
+	for (i32 detachedIndex = 0; detachedIndex < ui->detachedCount; detachedIndex++) {
+		if (ui->detachedWindows[detachedIndex] == winID) {
+			ui->detachedWindows[detachedIndex] = ui->detachedWindows[--ui->detachedCount];
+			break;
+		}
+	}
+	if (ui->cursorDetachedWindow == winID) {
+		ui->cursorDetachedWindow = UIWindowID_Invalid;
+	}
+	ui->windows.flags[winID] &= ~UIWindowFlag_Detached;
+}
+
+// NOTE(khvorov) Tears a floating window off into an os window of its own. It
+// keeps coordinates relative to the main window but it's not on the main
+// screen anymore, so nothing there can be under it or dock into it. Windows
+// with others docked into them stay, an os window shows one window.
+b32
+uiDetachWindow(UI* ui, UIWindowID winID) {
+	UIWindows* windows = &ui->windows;
+	u32 flags = windows->flags[winID];
+	b32 result = false;
+	if (ui->detachedCount < UI_DETACHED_MAX && !(flags & (UIWindowFlag_Detached | UIWindowFlag_Docked)) && windows->dockFirstChildren[winID] < 0) {
+		SDL_Rect winRect = uiGetWindowRect(ui, winID);
+		uiDamageRect(ui, winRect);
+		windows->flags[winID] |= UIWindowFlag_Detached;
+		ui->detachedWindows[ui->detachedCount++] = winID;
+		uiSpatialUpdateWindow(ui, winID);
+
+		// NOTE(khvorov) The new os window starts out empty
+		windows->dirtyRects[winID] = (SDL_Rect) {.w = winRect.w, .h = winRect.h};
+		result = true;
+	}
+	return result;
+}
+
+// NOTE(khvorov) Back onto the main screen, where the cached pixels are as old
+// as the tear off
+void
+uiAttachWindow(UI* ui, UIWindowID winID) {
+	if (ui->windows.flags[winID] & UIWindowFlag_Detached) {
+		uiForgetDetachedWindow(ui, winID);
+		uiSpatialUpdateWindow(ui, winID);
+		uiDamageWindow(ui, winID, uiGetWindowRect(ui, winID));
+	}
+}
+
+void
+uiSetSize(UI* ui, i32 width, i32 height) {
+	ui->width = width;
+	ui->height = height;
+	uiInvalidateLayout(ui, UIWindowID_Root);
+	uiLayout(ui);
+	uiSpatialRebuild(ui);
+	uiDamageEverything(ui);
+	if (ui->pick.enabled) {
+		pickResize(&ui->pick, width, height);
+	}
+}
+
+UIWindowID
+uiGetWindowID(UI* ui, UIWindowHandle handle) {
+	UIWindows* windows = &ui->windows;
+	UIWindowID result = UIWindowID_Invalid;
+	if (handle.id >= 0 && handle.id < windows->slotCount
+		&& (windows->flags[handle.id] & UIWindowFlag_Alive)
+		&& windows->generations[handle.id] == handle.generation) {
+		result = handle.id;
+	}
+	return result;
+}
+
+// NOTE(khvorov) Every tab draws the whole topbar, titles and colors of the
+// others included
+void
+uiDamageTabs(UI* ui, UIWindowID winID) {
+	UIWindows* windows = &ui->windows;
+	UIWindowID ownerID = uiGetTabOwner(ui, winID);
+	if (ownerID >= 0) {
+		uiDamageWindow(ui, ownerID, uiGetWindowTopbarRect(ui, ownerID));
+	}
+	for (UIWindowID childID = uiGetFirstDockChild(ui, ownerID); childID >= 0; childID = windows->dockNextSiblings[childID]) {
+		if (windows->dockPositions[childID] == DockPos_Center) {
+			uiDamageWindow(ui, childID, uiGetWindowTopbarRect(ui, childID));
+		}
+	}
+}
+
+void
+uiSetWindowTitle(UI* ui, UIWindowID winID, char* title) {
+	UIWindowTitle* winTitle = ui->windows.titles + winID;
+	winTitle->len = SDL_min((i32)SDL_strlen(title), UI_WINDOW_TITLE_CAP);
+	SDL_memcpy(winTitle->chars, title, winTitle->len);
+	uiDamageTabs(ui, winID);
+}
+
+UIWindowHandle
+uiCreateWindow(UI* ui, SDL_Rect rect, SDL_Color color) {
+	UIWindows* windows = &ui->windows;
+
+	UIWindowID winID = windows->firstFree;
+	if (winID >= 0) {
+		windows->firstFree = windows->nextFree[winID];
+	} else {
+		if (windows->slotCount == windows->cap) {
+			uiWindowsGrow(windows, ui->arena);
+		}
+		winID = windows->slotCount++;
+		windows->generations[winID] = 0;
+	}
+
+	windows->rects[winID] = rect;
+	windows->layoutRects[winID] = (SDL_Rect) {0};
+	windows->flags[winID] = UIWindowFlag_Alive;
+	windows->dockParents[winID] = UIWindowID_Invalid;
+	windows->dockPositions[winID] = DockPos_Center;
+	windows->dockFirstChildren[winID] = UIWindowID_Invalid;
+	windows->dockNextSiblings[winID] = UIWindowID_Invalid;
+	windows->dockPrevSiblings[winID] = UIWindowID_Invalid;
+	windows->dockAreas[winID] = (SDL_Rect) {0};
+	windows->dockSpaces[winID] = (SDL_Rect) {0};
+	windows->dockFractions[winID] = 0.5f;
+	windows->topbarRects[winID] = (SDL_Rect) {0};
+	windows->contentRects[winID] = (SDL_Rect) {0};
+	windows->tabRects[winID] = (SDL_Rect) {0};
+	windows->colors[winID] = color;
+	windows->titles[winID].len = 0;
+	windows->contents[winID] = UIWindowContent_None;
+	windows->dirtyRects[winID] = (SDL_Rect) {.w = rect.w, .h = rect.h};
+	windows->dragOffsets[winID] = (SDL_Point) {0};
+	windows->spatialRects[winID] = (SDL_Rect) {0};
+	windows->splitterRects[winID] = (SDL_Rect) {0};
+	windows->nextFree[winID] = UIWindowID_Invalid;
+
+	// NOTE(khvorov) New windows go on top
+	uiLinkWindowAtFront(windows, winID);
+	windows->liveCount += 1;
+
+	uiInvalidateLayout(ui, winID);
+	uiLayout(ui);
+
+	UIWindowHandle handle = {.id = winID, .generation = windows->generations[winID]};
+	return handle;
+}
+
+void
+uiDestroyWindow(UI* ui, UIWindowHandle handle) {
+	UIWindows* windows = &ui->windows;
+	UIWindowID winID = uiGetWindowID(ui, handle);
+	if (winID >= 0) {
+		if (windows->flags[winID] & UIWindowFlag_Detached) {
+			uiForgetDetachedWindow(ui, winID);
+		} else {
+			uiDamageRect(ui, uiGetWindowRect(ui, winID));
+		}
+
+		// NOTE(khvorov) Windows docked into this one stay where they are
+		while (windows->dockFirstChildren[winID] >= 0) {
+			uiUndock(ui, windows->dockFirstChildren[winID]);
+		}
+		uiUndock(ui, winID);
+
+		uiUnlinkWindowOrder(windows, winID);
+		windows->liveCount -= 1;
+
+		if (ui->draggedWindow == winID) {
+			ui->draggedWindow = UIWindowID_Invalid;
+		}
+		if (ui->scrollDraggedWindow == winID) {
+			ui->scrollDraggedWindow = UIWindowID_Invalid;
+		}
+		if (ui->draggedSplitter == winID) {
+			ui->draggedSplitter = UIWindowID_Invalid;
+		}
+
+		windows->flags[winID] = 0;
+		uiSpatialUpdateWindow(ui, winID);
+		windows->generations[winID] += 1;
+		windows->nextFree[winID] = windows->firstFree;
+		windows->firstFree = winID;
+
+		uiLayout(ui);
+	}
+}
+
+void
+uiInit(UI* ui, Arena* arena) {
+	SDL_memset(ui, 0, sizeof(UI));
+	ui->arena = arena;
+	ui->spatial.arena = arena;
+	ui->windows.firstFree = UIWindowID_Invalid;
+	ui->windows.front = UIWindowID_Invalid;
+	ui->windows.back = UIWindowID_Invalid;
+	ui->draggedWindow = UIWindowID_Invalid;
+	ui->draggedSplitter = UIWindowID_Invalid;
+	ui->rootDockFirstChild = UIWindowID_Invalid;
+	ui->profilerWindow.id = UIWindowID_Invalid;
+	ui->listDemoWindow.id = UIWindowID_Invalid;
+	ui->scrollDraggedWindow = UIWindowID_Invalid;
+	ui->cursorDetachedWindow = UIWindowID_Invalid;
+
+	ui->windowTopBarHeight = 20;
+	ui->windowBorderThickness = 2;
+	ui->listRowHeight = 18;
+	ui->scrollbarWidth = 10;
+
+	{
+		SDL_Rect rect = {.x = 100, .y = 100, .w = 100, .h = 200};
+		SDL_Color color = {.r = 0, .g = 255, .b = 0, .a = 255};
+		UIWindowHandle handle = uiCreateWindow(ui, rect, color);
+		uiSetWindowTitle(ui, handle.id, "green");
+	}
+
+	{
+		SDL_Rect rect = {.x = 0, .y = 0, .w = 200, .h = 100};
+		SDL_Color color = {.r = 255, .g = 0, .b = 0, .a = 255};
+		UIWindowHandle handle = uiCreateWindow(ui, rect, color);
+		uiSetWindowTitle(ui, handle.id, "red");
+	}
+}
+
+void
+uiSetWindowList(UI* ui, UIWindowID winID, i64 rowCount, UIListGetRow getRow, void* getRowData) {
+	UIList* list = ui->windows.lists + winID;
+	list->rowCount = rowCount;
+	list->scrollY = 0;
+	list->getRow = getRow;
+	list->getRowData = getRowData;
+	ui->windows.contents[winID] = UIWindowContent_List;
+	uiDamageWindow(ui, winID, uiGetWindowContentRect(ui, winID));
+}
+
+SDL_Rect
+uiListGetRowsRect(UI* ui, UIWindowID winID) {
+	SDL_Rect result = uiGetWindowContentRect(ui, winID);
+	result.w = SDL_max(result.w - ui->scrollbarWidth, 0);
+	return result;
+}
+
+i64
+uiListGetScrollMax(UI* ui, UIWindowID winID) {
+	UIList* list = ui->windows.lists + winID;
+	i64 contentHeight = list->rowCount * (i64)ui->listRowHeight;
+	i64 result = SDL_max(contentHeight - (i64)uiListGetRowsRect(ui, winID).h, 0);
+	return result;
+}
+
+// NOTE(khvorov) The content rect can shrink after the list was scrolled, so
+// everything that reads the scroll position goes through here
+i64
+uiListGetScroll(UI* ui, UIWindowID winID) {
+	i64 result = SDL_min(ui->windows.lists[winID].scrollY, uiListGetScrollMax(ui, winID));
+	return result;
+}
+
+void
+uiListScrollTo(UI* ui, UIWindowID winID, i64 scrollY) {
+	scrollY = SDL_max(SDL_min(scrollY, uiListGetScrollMax(ui, winID)), 0);
+	if (scrollY != uiListGetScroll(ui, winID)) {
+		ui->windows.lists[winID].scrollY = scrollY;
+		uiDamageWindow(ui, winID, uiGetWindowContentRect(ui, winID));
+	}
+}
+
+void
+uiListGetScrollbarRects(UI* ui, UIWindowID winID, SDL_Rect* track, SDL_Rect* thumb) {
+	SDL_Rect contentRect = uiGetWindowContentRect(ui, winID);
+	*track = contentRect;
+	track->x = contentRect.x + contentRect.w - ui->scrollbarWidth;
+	track->w = SDL_min(ui->scrollbarWidth, contentRect.w);
+
+	UIList* list = ui->windows.lists + winID;
+	i64 contentHeight = SDL_max(list->rowCount * (i64)ui->listRowHeight, 1);
+	i64 scrollMax = uiListGetScrollMax(ui, winID);
+	i32 thumbHeight = (i32)SDL_min((i64)track->h * (i64)track->h / contentHeight, (i64)track->h);
+	thumbHeight = SDL_min(SDL_max(thumbHeight, 20), track->h);
+	i32 thumbTravel = track->h - thumbHeight;
+	i32 thumbOffset = scrollMax > 0 ? (i32)((f64)uiListGetScroll(ui, winID) / (f64)scrollMax * (f64)thumbTravel) : 0;
+
+	*thumb = *track;
+	thumb->y = track->y + thumbOffset;
+	thumb->h = thumbHeight;
+}
+
+// NOTE(khvorov) For lists whose rows are still arriving. Only the scrollbar
+// changes unless the new rows land in view.
+void
+uiListSetRowCount(UI* ui, UIWindowID winID, i64 rowCount) {
+	UIList* list = ui->windows.lists + winID;
+	if (list->rowCount != rowCount) {
+		SDL_Rect rowsRect = uiListGetRowsRect(ui, winID);
+		i64 visibleEnd = uiListGetScroll(ui, winID) + rowsRect.h;
+		b32 rowsInView = SDL_min(list->rowCount, rowCount) * (i64)ui->listRowHeight < visibleEnd;
+		list->rowCount = rowCount;
+		if (rowsInView) {
+			uiDamageWindow(ui, winID, uiGetWindowContentRect(ui, winID));
+		} else {
+			SDL_Rect track, thumb;
+			uiListGetScrollbarRects(ui, winID, &track, &thumb);
+			uiDamageWindow(ui, winID, track);
+		}
+	}
+}
+
+// NOTE(khvorov) grabY is where on the thumb the cursor is holding it
+void
+uiListDragThumb(UI* ui, UIWindowID winID, i32 cursorY, i32 grabY) {
+	SDL_Rect track, thumb;
+	uiListGetScrollbarRects(ui, winID, &track, &thumb);
+	i32 thumbTravel = track.h - thumb.h;
+	if (thumbTravel > 0) {
+		f64 fraction = (f64)(cursorY - grabY - track.y) / (f64)thumbTravel;
+		fraction = SDL_max(SDL_min(fraction, 1.0), 0.0);
+		uiListScrollTo(ui, winID, (i64)(fraction * (f64)uiListGetScrollMax(ui, winID)));
+	}
+}
+
+// NOTE(khvorov) data is the label every row starts with
+i32
+uiListDemoGetRow(void* data, i64 row, char* buf, i32 bufCap) {
+	char* label = (char*)data;
+	u32 hash = (u32)row * 2654435761u;
+	i32 result = SDL_snprintf(buf, bufCap, "%s %lld  %08x", label, (long long)row, hash);
+	result = SDL_min(result, bufCap - 1);
+	return result;
+}
+
+// NOTE(khvorov) Tabs share the topbar, the one under the cursor is the one
+// that was clicked whichever of them is in front
+UIWindowID
+uiGetTabAt(UI* ui, UIWindowID winID, i32 pointX, i32 pointY) {
+	UIWindows* windows = &ui->windows;
+	UIWindowID result = winID;
+	UIWindowID ownerID = uiGetTabOwner(ui, winID);
+	if (ownerID >= 0 && pointInRect(pointX, pointY, windows->tabRects[ownerID])) {
+		result = ownerID;
+	}
+	for (UIWindowID childID = uiGetFirstDockChild(ui, ownerID); childID >= 0; childID = windows->dockNextSiblings[childID]) {
+		if (windows->dockPositions[childID] == DockPos_Center && pointInRect(pointX, pointY, windows->tabRects[childID])) {
+			result = childID;
+		}
+	}
+	return result;
+}
+
+// NOTE(khvorov) Both sides of the splitter keep enough room for a topbar. Only
+// the parent is invalidated, its layout pass skips the children that didn't move.
+void
+uiDragSplitter(UI* ui, UIWindowID winID, i32 cursorX, i32 cursorY) {
+	UIWindows* windows = &ui->windows;
+	SDL_Rect space = windows->dockSpaces[winID];
+	i32 extent = 0;
+	i32 offset = 0;
+	switch (windows->dockPositions[winID]) {
+	case DockPos_Left: {extent = space.w; offset = cursorX - space.x;} break;
+	case DockPos_Right: {extent = space.w; offset = space.x + space.w - cursorX;} break;
+	case DockPos_Top: {extent = space.h; offset = cursorY - space.y;} break;
+	case DockPos_Bottom: {extent = space.h; offset = space.y + space.h - cursorY;} break;
+	case DockPos_Center: case DockPos_Count: break;
+	}
+
+	i32 minSize = ui->windowTopBarHeight + 2 * ui->windowBorderThickness;
+	if (extent > 2 * minSize) {
+		offset = SDL_max(SDL_min(offset, extent - minSize), minSize);
+		f32 fraction = (f32)offset / (f32)extent;
+		if (fraction != windows->dockFractions[winID]) {
+			windows->dockFractions[winID] = fraction;
+			uiInvalidateLayout(ui, windows->dockParents[winID]);
+		}
+	}
+}
+
+// NOTE(khvorov) The topmost window under the point that isn't being dragged
+// along with draggedID. Docking into a tab docks into its owner.
+UIWindowID
+uiGetDockHostAt(UI* ui, i32 pointX, i32 pointY, UIWindowID draggedID) {
+	UIWindows* windows = &ui->windows;
+	UIWindowID topmostID = UIWindowID_Invalid;
+	SpatialCell* cell = spatialGetCell(&ui->spatial, pointX, pointY);
+	if (cell) {
+		i32 bestZKey = INT32_MIN;
+		for (i32 itemIndex = 0; itemIndex < cell->count; itemIndex++) {
+			SpatialItem item = cell->items[itemIndex];
+			if (item.kind == SpatialItemKind_Window) {
+				i32 zKey = windows->zKeys[item.id];
+				if ((topmostID == UIWindowID_Invalid || zKey > bestZKey) && pointInRect(pointX, pointY, windows->spatialRects[item.id])) {
+					b32 dragged = false;
+					for (UIWindowID ancestorID = item.id; ancestorID >= 0; ancestorID = windows->dockParents[ancestorID]) {
+						dragged = dragged || ancestorID == draggedID;
+					}
+					if (!dragged) {
+						bestZKey = zKey;
+						topmostID = item.id;
+					}
+				}
+			}
+		}
+	}
+
+	UIWindowID result = UIWindowID_Root;
+	if (topmostID >= 0) {
+		result = uiGetTabOwner(ui, topmostID);
+	}
+	return result;
+}
+
+SDL_Rect
+uiGetDockCrossBounds(UIDockTarget* targets, i32 targetCount) {
+	SDL_Rect result = {0};
+	for (i32 targetIndex = UI_DOCK_EDGE_TARGETS; targetIndex < targetCount; targetIndex++) {
+		SDL_Rect rect = targets[targetIndex].rect;
+		result = targetIndex == UI_DOCK_EDGE_TARGETS ? rect : rectUnion(result, rect);
+	}
+	return result;
+}
+
+// NOTE(khvorov) Targets for the edges of the screen and a cross over the host,
+// none when hostID is invalid. They're drawn over everything so only the
+// screen is damaged when they change.
+void
+uiSetDockTargets(UI* ui, UIWindowID hostID, b32 tabsAllowed) {
+	UIDockTarget targets[UI_DOCK_TARGETS_MAX];
+	i32 targetCount = 0;
+	if (hostID != UIWindowID_Invalid) {
+		i32 size = 2 * ui->windowTopBarHeight;
+		i32 gap = 2 * ui->windowBorderThickness;
+		i32 edgeOffset = gap + size / 2;
+		targets[targetCount++] = (UIDockTarget) {.host = UIWindowID_Root, .pos = DockPos_Left, .rect = rectCenterDim(edgeOffset, ui->height / 2, size, size)};
+		targets[targetCount++] = (UIDockTarget) {.host = UIWindowID_Root, .pos = DockPos_Right, .rect = rectCenterDim(ui->width - edgeOffset, ui->height / 2, size, size)};
+		targets[targetCount++] = (UIDockTarget) {.host = UIWindowID_Root, .pos = DockPos_Top, .rect = rectCenterDim(ui->width / 2, edgeOffset, size, size)};
+		targets[targetCount++] = (UIDockTarget) {.host = UIWindowID_Root, .pos = DockPos_Bottom, .rect = rectCenterDim(ui->width / 2, ui->height - edgeOffset, size, size)};
+
+		SDL_Rect hostRect = uiGetWindowRect(ui, hostID);
+		i32 centerX = hostRect.x + hostRect.w / 2;
+		i32 centerY = hostRect.y + hostRect.h / 2;
+		i32 step = size + gap;
+		if (tabsAllowed) {
+			targets[targetCount++] = (UIDockTarget) {.host = hostID, .pos = DockPos_Center, .rect = rectCenterDim(centerX, centerY, size, size)};
+		}
+		targets[targetCount++] = (UIDockTarget) {.host = hostID, .pos = DockPos_Left, .rect = rectCenterDim(centerX - step, centerY, size, size)};
+		targets[targetCount++] = (UIDockTarget) {.host = hostID, .pos = DockPos_Right, .rect = rectCenterDim(centerX + step, centerY, size, size)};
+		targets[targetCount++] = (UIDockTarget) {.host = hostID, .pos = DockPos_Top, .rect = rectCenterDim(centerX, centerY - step, size, size)};
+		targets[targetCount++] = (UIDockTarget) {.host = hostID, .pos = DockPos_Bottom, .rect = rectCenterDim(centerX, centerY + step, size, size)};
+	}
+
+	// NOTE(khvorov) The edge targets stay put for the whole drag and the cross
+	// moves as one, so it's damaged as one rect. The draw pass culls every
+	// window against every damage rect.
+	i32 oldCount = ui->dockTargetCount;
+	b32 crossChanged = targetCount != oldCount;
+	for (i32 targetIndex = 0; targetIndex < SDL_max(targetCount, oldCount); targetIndex++) {
+		UIDockTarget* target = targets + targetIndex;
+		UIDockTarget* old = ui->dockTargets + targetIndex;
+		b32 changed = targetIndex >= targetCount || targetIndex >= oldCount
+			|| target->host != old->host || target->pos != old->pos || !rectsEqual(target->rect, old->rect);
+		if (changed && targetIndex < UI_DOCK_EDGE_TARGETS) {
+			if (targetIndex < oldCount) {
+				uiDamageRect(ui, old->rect);
+			}
+			if (targetIndex < targetCount) {
+				uiDamageRect(ui, target->rect);
+			}
+		}
+		crossChanged = crossChanged || (changed && targetIndex >= UI_DOCK_EDGE_TARGETS);
+	}
+
+	if (crossChanged) {
+		uiDamageRect(ui, uiGetDockCrossBounds(ui->dockTargets, oldCount));
+		uiDamageRect(ui, uiGetDockCrossBounds(targets, targetCount));
+	}
+	for (i32 targetIndex = 0; targetIndex < targetCount; targetIndex++) {
+		ui->dockTargets[targetIndex] = targets[targetIndex];
+	}
+	ui->dockTargetCount = targetCount;
+}
+
+void
+uiWindowUpdate(UI* ui, UIWindowID winID, Input* input) {
+
+	UIWindows* windows = &ui->windows;
+	SDL_Rect* rect = windows->rects + winID;
+	u32* flags = windows->flags + winID;
+	SDL_Color* color = windows->colors + winID;
+	SDL_Point* dragOffset = windows->dragOffsets + winID;
+
+	SDL_Rect winRect = uiGetWindowRect(ui, winID);
+	SDL_Color winColorBefore = *color;
+
+	if (wasPressed(input, InputKeyID_MouseLeft)) {
+
+		if (pointInRect(input->cursorX, input->cursorY, winRect)) {
+			if (windows->front != winID) {
+				uiMoveWindowToFront(ui, winID);
+				uiDamageRect(ui, winRect);
+			}
+			input->keys[InputKeyID_MouseLeft].halfTransitionCount = 0;
+		}
+
+		if (windows->contents[winID] == UIWindowContent_List) {
+			SDL_Rect track, thumb;
+			uiListGetScrollbarRects(ui, winID, &track, &thumb);
+			if (pointInRect(input->cursorX, input->cursorY, track)) {
+				ui->scrollDraggedWindow = winID;
+				ui->scrollDragGrabY = pointInRect(input->cursorX, input->cursorY, thumb) ? input->cursorY - thumb.y : thumb.h / 2;
+				uiListDragThumb(ui, winID, input->cursorY, ui->scrollDragGrabY);
+			}
+		}
+
+		// NOTE(khvorov) Dragging. Docked windows stay where they are until the
+		// cursor moves far enough, so that clicking a tab only switches to it.
+		UIPick pick = uiPickAt(ui, input->cursorX, input->cursorY);
+		b32 inTopbar = pick.part == UIWindowPart_Topbar && pointInRect(input->cursorX, input->cursorY, windows->tabRects[winID]);
+		if (inTopbar && pick.window >= 0 && uiGetTabOwner(ui, pick.window) == uiGetTabOwner(ui, winID)) {
+			*flags |= UIWindowFlag_Dragged;
+			ui->draggedWindow = winID;
+			ui->dragStart = (SDL_Point) {.x = input->cursorX, .y = input->cursorY};
+			dragOffset->x = input->cursorX - rect->x;
+			dragOffset->y = input->cursorY - rect->y;
+			color->b = 255;
+		}
+
+	} else if (wasUnpressed(input, InputKeyID_MouseLeft) && (*flags & UIWindowFlag_Dragged)) {
+
+		// NOTE(khvorov) Let go outside the main window the window gets torn off
+		// into an os window. A torn off window comes back once it's dropped
+		// whole inside the main window.
+		i32 targetIndex = uiPickAt(ui, input->cursorX, input->cursorY).dockTarget;
+		SDL_Rect screenRect = {.x = 0, .y = 0, .w = ui->width, .h = ui->height};
+		SDL_Rect newRect = uiGetWindowRect(ui, winID);
+		if (targetIndex >= 0) {
+			UIDockTarget target = ui->dockTargets[targetIndex];
+			uiAttachWindow(ui, winID);
+			uiDock(ui, winID, target.host, target.pos);
+		} else if (*flags & UIWindowFlag_Detached) {
+			if (rectsEqual(rectIntersect(newRect, screenRect), newRect)) {
+				uiAttachWindow(ui, winID);
+			}
+		} else if (!pointInRect(input->cursorX, input->cursorY, screenRect)) {
+			uiDetachWindow(ui, winID);
+		}
+
+		*flags &= ~UIWindowFlag_Dragged;
+		ui->draggedWindow = UIWindowID_Invalid;
+		dragOffset->x = 0;
+		dragOffset->y = 0;
+		color->b = 0;
+	}
+
+	if (*flags & UIWindowFlag_Dragged) {
+		SDL_Point dragStart = ui->dragStart;
+		i32 dragDistance = SDL_abs(input->cursorX - dragStart.x) + SDL_abs(input->cursorY - dragStart.y);
+		if ((*flags & UIWindowFlag_Docked) && dragDistance >= UI_TEAR_OFF_DISTANCE) {
+			SDL_Rect windowTopbarRect = uiGetWindowTopbarRect(ui, winID);
+			f32 clickX01 = (f32)(dragStart.x - winRect.x) / (f32)windowTopbarRect.w;
+			i32 clickYOffset = dragStart.y - winRect.y;
+
+			uiUndock(ui, winID);
+
+			SDL_Rect newTopBar = uiTopbarRectFromWindowRect(ui, *rect);
+			rect->x = dragStart.x - ui->windowBorderThickness - (i32)(clickX01 * (f32)newTopBar.w);
+			rect->y = dragStart.y - clickYOffset;
+			dragOffset->x = dragStart.x - rect->x;
+			dragOffset->y = dragStart.y - rect->y;
+		}
+
+		if (!(*flags & UIWindowFlag_Docked)) {
+			SDL_Rect newRect = *rect;
+			newRect.x = input->cursorX - dragOffset->x;
+			newRect.y = input->cursorY - dragOffset->y;
+			uiSetWindowRect(ui, winID, newRect);
+		}
+	}
+
+	// NOTE(khvorov) Moves are damaged by the layout pass
+	if (SDL_memcmp(&winColorBefore, color, sizeof(SDL_Color)) != 0) {
+		uiDamageTabs(ui, winID);
+	}
+}
+
+// NOTE(khvorov) Only the topmost window under the cursor can react to a
+// press and only the dragged window can react to a release or cursor motion
+void
+uiUpdate(UI* ui, Input* input) {
+	if (wasPressed(input, InputKeyID_F1)) {
+		if (uiGetWindowID(ui, ui->profilerWindow) >= 0) {
+			uiDestroyWindow(ui, ui->profilerWindow);
+		} else {
+			SDL_Rect rect = {.x = 50, .y = 50, .w = 2 * PROFILE_FRAMES_CAP + 2 * ui->windowBorderThickness, .h = 200};
+			SDL_Color color = {.r = 150, .g = 150, .b = 0, .a = 255};
+			ui->profilerWindow = uiCreateWindow(ui, rect, color);
+			ui->windows.contents[ui->profilerWindow.id] = UIWindowContent_Profiler;
+			uiSetWindowTitle(ui, ui->profilerWindow.id, "profiler");
+		}
+	}
+
+	if (wasPressed(input, InputKeyID_F3)) {
+		if (uiGetWindowID(ui, ui->listDemoWindow) >= 0) {
+			uiDestroyWindow(ui, ui->listDemoWindow);
+		} else {
+			SDL_Rect rect = {.x = 300, .y = 100, .w = 300, .h = 400};
+			SDL_Color color = {.r = 0, .g = 150, .b = 150, .a = 255};
+			ui->listDemoWindow = uiCreateWindow(ui, rect, color);
+			uiSetWindowTitle(ui, ui->listDemoWindow.id, "10M rows");
+			uiSetWindowList(ui, ui->listDemoWindow.id, 10 * 1000 * 1000, uiListDemoGetRow, "row");
+		}
+	}
+
+	if (input->scrollY != 0) {
+		UIWindowID hoveredID = uiPickAt(ui, input->cursorX, input->cursorY).window;
+		if (hoveredID >= 0 && ui->windows.contents[hoveredID] == UIWindowContent_List) {
+			i64 scrollDelta = (i64)(input->scrollY * (f32)(3 * ui->listRowHeight));
+			uiListScrollTo(ui, hoveredID, uiListGetScroll(ui, hoveredID) - scrollDelta);
+		}
+	}
+
+	UIWindowID scrollDraggedID = ui->scrollDraggedWindow;
+	if (scrollDraggedID >= 0) {
+		if (wasUnpressed(input, InputKeyID_MouseLeft)) {
+			ui->scrollDraggedWindow = UIWindowID_Invalid;
+		} else {
+			uiListDragThumb(ui, scrollDraggedID, input->cursorY, ui->scrollDragGrabY);
+		}
+	}
+
+	// NOTE(khvorov) Splitters sit on the borders of the windows they're between
+	// so they get the press first
+	if (wasPressed(input, InputKeyID_MouseLeft)) {
+		UIWindowID splitterID = uiGetSplitterAt(ui, input->cursorX, input->cursorY);
+		if (splitterID >= 0) {
+			ui->draggedSplitter = splitterID;
+			input->keys[InputKeyID_MouseLeft].halfTransitionCount = 0;
+		}
+	}
+
+	UIWindowID draggedSplitterID = ui->draggedSplitter;
+	if (draggedSplitterID >= 0) {
+		if (wasUnpressed(input, InputKeyID_MouseLeft)) {
+			ui->draggedSplitter = UIWindowID_Invalid;
+		} else {
+			uiDragSplitter(ui, draggedSplitterID, input->cursorX, input->cursorY);
+		}
+	}
+
+	UIWindowID pressedID = UIWindowID_Invalid;
+	if (wasPressed(input, InputKeyID_MouseLeft)) {
+		UIPick pick = uiPickAt(ui, input->cursorX, input->cursorY);
+		pressedID = pick.window;
+		if (pressedID >= 0 && pick.part == UIWindowPart_Topbar) {
+			pressedID = uiGetTabAt(ui, pressedID, input->cursorX, input->cursorY);
+		}
+		if (pressedID >= 0) {
+			uiWindowUpdate(ui, pressedID, input);
+		}
+	}
+
+	UIWindowID draggedID = ui->draggedWindow;
+	if (draggedID >= 0 && draggedID != pressedID) {
+		uiWindowUpdate(ui, draggedID, input);
+	}
+
+	uiLayout(ui);
+
+	// NOTE(khvorov) Once the dragged window is torn off it can be docked again
+	UIWindowID dockHostID = UIWindowID_Invalid;
+	b32 tabsAllowed = false;
+	draggedID = ui->draggedWindow;
+	if (draggedID >= 0 && !(ui->windows.flags[draggedID] & UIWindowFlag_Docked)) {
+		dockHostID = uiGetDockHostAt(ui, input->cursorX, input->cursorY, draggedID);
+		tabsAllowed = ui->windows.dockFirstChildren[draggedID] < 0;
+	}
+	uiSetDockTargets(ui, dockHostID, tabsAllowed);
+}
+
+void
+drawListClear(DrawList* list, Arena* frameArena) {
+	SDL_memset(list, 0, sizeof(DrawList));
+	list->arena = frameArena;
+}
+
+// NOTE(khvorov) Nothing else comes out of the frame arena while the list is
+// being recorded so the command array grows in place and can start small
+void
+drawListPush(DrawList* list, DrawCmd cmd) {
+	cmd.rect.x -= list->origin.x;
+	cmd.rect.y -= list->origin.y;
+	if (list->cmdCount == list->cmdCap) {
+		i32 newCap = list->cmdCap == 0 ? 32 : list->cmdCap * 2;
+		list->cmds = arenaGrowArray(list->arena, list->cmds, list->cmdCap, newCap, sizeof(*list->cmds));
+		list->cmdCap = newCap;
+	}
+	list->cmds[list->cmdCount++] = cmd;
+}
+
+void
+drawRect(DrawList* list, SDL_Rect rect, SDL_Color color) {
+	DrawCmd cmd = {.kind = DrawCmdKind_Rect, .rect = rect, .color = color};
+	drawListPush(list, cmd);
+}
+
+void
+drawGlyph(DrawList* list, SDL_Rect rect, SDL_Rect texRect, SDL_Color color) {
+	DrawCmd cmd = {.kind = DrawCmdKind_Glyph, .rect = rect, .color = color, .texRect = texRect};
+	drawListPush(list, cmd);
+}
+
+void
+drawWindowImage(DrawList* list, UIWindowID winID, SDL_Rect rect, SDL_Rect texRect) {
+	DrawCmd cmd = {.kind = DrawCmdKind_Image, .rect = rect, .texRect = texRect, .window = winID};
+	drawListPush(list, cmd);
+}
+
+void
+drawRectOutline(DrawList* list, SDL_Rect rect, SDL_Color color, i32 thickness) {
+	SDL_Rect outlineRects[Direction_Count];
+	getOutlineRects(rect, outlineRects, thickness);
+	for (Direction dir = 0; dir < Direction_Count; dir++) {
+		SDL_Rect outlineRect = outlineRects[dir];
+		drawRect(list, outlineRect, color);
+	}
+}
+
+// NOTE(khvorov) One glyph command per visible glyph, clipped to clipRect on
+// the way in. Glyphs that are still being rasterized get a box of about the
+// right size. Returns the x the pen ended at.
+i32
+drawText(DrawList* list, Font* font, char* str, i32 len, i32 x, i32 y, SDL_Rect clipRect, SDL_Color color) {
+	i32 penX = x;
+	i32 baseline = y + font->ascender;
+	for (i32 byteIndex = 0; byteIndex < len;) {
+		u32 codepoint = 0;
+		byteIndex += utf8Decode(str + byteIndex, len - byteIndex, &codepoint);
+		Glyph* glyph = fontGetGlyph(font, codepoint);
+		if (glyph && glyph->state == GlyphState_Pending) {
+			i32 placeholderAdvance = font->pixelHeight / 2;
+			SDL_Rect placeholderRect = {.x = penX + 1, .y = baseline - font->ascender + 2, .w = placeholderAdvance - 2, .h = font->ascender - 2};
+			SDL_Rect visible = rectIntersect(placeholderRect, clipRect);
+			if (rectArea(visible) > 0) {
+				drawRectOutline(list, visible, color, 1);
+				damageAdd(&font->placeholderDamage, visible);
+			}
+			penX += placeholderAdvance;
+		} else if (glyph && glyph->state == GlyphState_Ready) {
+			SDL_Rect glyphRect = {
+				.x = penX + glyph->offsetX, .y = baseline + glyph->offsetY,
+				.w = glyph->texRect.w, .h = glyph->texRect.h,
+			};
+			SDL_Rect visible = rectIntersect(glyphRect, clipRect);
+			if (rectArea(visible) > 0) {
+				SDL_Rect texRect = {
+					.x = glyph->texRect.x + visible.x - glyphRect.x, .y = glyph->texRect.y + visible.y - glyphRect.y,
+					.w = visible.w, .h = visible.h,
+				};
+				drawGlyph(list, visible, texRect, color);
+			}
+			penX += glyph->advance;
+		}
+	}
+	return penX;
+}
+
+// NOTE(khvorov) One column per frame, newest on the right, zones stacked
+// bottom to top. The full height is two refresh intervals at 60hz.
+void
+drawProfilerGraph(DrawList* list, Font* font, SDL_Rect rect) {
+	Profiler* profiler = &globalProfiler;
+	i32 columnWidth = 2;
+	f64 ticksPerPixel = (2.0 / 60.0) * (f64)SDL_GetPerformanceFrequency() / (f64)rect.h;
+	i32 frameCount = SDL_min(SDL_min(rect.w / columnWidth, PROFILE_FRAMES_CAP), (i32)profiler->framesEnded);
+
+	for (i32 frameOffset = 0; frameOffset < frameCount; frameOffset++) {
+		ProfileFrame* frame = profiler->frames + ((profiler->framesEnded - 1 - frameOffset) % PROFILE_FRAMES_CAP);
+		i32 columnX = rect.x + rect.w - (frameOffset + 1) * columnWidth;
+		i32 columnBottom = rect.y + rect.h;
+		for (ProfileZoneKind kind = 0; kind < ProfileZoneKind_Count && columnBottom > rect.y; kind++) {
+			i32 height = (i32)((f64)frame->zoneTicks[kind] / ticksPerPixel);
+			height = SDL_min(height, columnBottom - rect.y);
+			if (height > 0) {
+				SDL_Rect zoneRect = {.x = columnX, .y = columnBottom - height, .w = columnWidth, .h = height};
+				drawRect(list, zoneRect, profileGetZoneColor(kind));
+				columnBottom -= height;
+			}
+		}
+
+		// NOTE(khvorov) Latency is not a part of the frame so it's a mark on the same scale
+		if (frame->inputToPresentTicks > 0) {
+			i32 height = SDL_min((i32)((f64)frame->inputToPresentTicks / ticksPerPixel), rect.h);
+			SDL_Rect markRect = {.x = columnX, .y = rect.y + rect.h - height, .w = columnWidth, .h = columnWidth};
+			drawRect(list, rectIntersect(markRect, rect), profileGetZoneColor(ProfileZoneKind_InputToPresent));
+		}
+	}
+
+	SDL_Rect frameBudgetLine = {.x = rect.x, .y = rect.y + rect.h / 2, .w = rect.w, .h = 1};
+	SDL_Color frameBudgetColor = {.r = 150, .g = 150, .b = 150, .a = 255};
+	drawRect(list, frameBudgetLine, frameBudgetColor);
+
+	i32 legendX = rect.x + 4;
+	for (ProfileZoneKind kind = 0; kind < ProfileZoneKind_Count; kind++) {
+		char* name = profileGetZoneName(kind);
+		legendX = drawText(list, font, name, (i32)SDL_strlen(name), legendX, rect.y + 2, rect, profileGetZoneColor(kind));
+		legendX += font->lineHeight / 2;
+	}
+
+	if (profiler->framesEnded > 0) {
+		ProfileFrame* lastFrame = profiler->frames + ((profiler->framesEnded - 1) % PROFILE_FRAMES_CAP);
+		char stats[96];
+		i32 statsLen = SDL_snprintf(
+			stats, sizeof(stats), "pixels touched %d, overdraw %.2fx, %.2fx unculled",
+			(i32)lastFrame->counters[ProfileCounterKind_PixelsTouched],
+			lastFrame->counters[ProfileCounterKind_Overdraw], lastFrame->counters[ProfileCounterKind_OverdrawUnculled]
+		);
+		SDL_Color statsColor = {.r = 200, .g = 200, .b = 200, .a = 255};
+		drawText(list, font, stats, statsLen, rect.x + 4, rect.y + 2 + font->lineHeight, rect, statsColor);
+
+		char draws[96];
+		i32 drawsLen = SDL_snprintf(
+			draws, sizeof(draws), "draw commands %d in %d batches, windows %d rendered, %d culled",
+			(i32)lastFrame->counters[ProfileCounterKind_DrawCmds], (i32)lastFrame->counters[ProfileCounterKind_DrawBatches],
+			(i32)lastFrame->counters[ProfileCounterKind_WindowsRendered], (i32)lastFrame->counters[ProfileCounterKind_WindowsCulled]
+		);
+		drawText(list, font, draws, drawsLen, rect.x + 4, rect.y + 2 + 2 * font->lineHeight, rect, statsColor);
+
+		char present[96];
+		i32 presentLen = SDL_snprintf(
+			present, sizeof(present), "present %s: %s, %u frames ago, %d skipped", presentGetModeName(profiler->presentMode),
+			presentGetReasonName(profiler->presentReason), profiler->framesEnded - profiler->presentSwitchFrame,
+			(i32)lastFrame->counters[ProfileCounterKind_FramesSkipped]
+		);
+		drawText(list, font, present, presentLen, rect.x + 4, rect.y + 2 + 3 * font->lineHeight, rect, statsColor);
+
+		i32 counts[PROFILE_LATENCY_BUCKETS];
+		i32 total = profileCopyInputToPresentCounts(counts);
+		if (total > 0) {
+			char latency[64];
+			i32 latencyLen = SDL_snprintf(
+				latency, sizeof(latency), "input to present p50 %dms, p99 %dms",
+				profileGetInputToPresentPercentile(counts, total, 50), profileGetInputToPresentPercentile(counts, total, 99)
+			);
+			drawText(list, font, latency, latencyLen, rect.x + 4, rect.y + 2 + 4 * font->lineHeight, rect, statsColor);
+		}
+	}
+}
+
+// NOTE(khvorov) Only the rows that intersect the content rect are visited
+void
+drawListView(DrawList* list, UI* ui, Font* font, UIWindowID winID) {
+	UIList* uiList = ui->windows.lists + winID;
+	SDL_Rect rowsRect = uiListGetRowsRect(ui, winID);
+	i64 scrollY = uiListGetScroll(ui, winID);
+	i32 rowHeight = ui->listRowHeight;
+
+	SDL_Color stripeColor = {.r = 20, .g = 20, .b = 20, .a = 255};
+	SDL_Color textColor = {.r = 200, .g = 200, .b = 200, .a = 255};
+	i32 textOffsetY = (rowHeight - font->lineHeight) / 2;
+
+	i64 firstRow = scrollY / rowHeight;
+	i32 rowY = rowsRect.y - (i32)(scrollY % rowHeight);
+	for (i64 row = firstRow; row < uiList->rowCount && rowY < rowsRect.y + rowsRect.h; row++, rowY += rowHeight) {
+		if (row & 1) {
+			SDL_Rect stripe = rectIntersect((SDL_Rect) {.x = rowsRect.x, .y = rowY, .w = rowsRect.w, .h = rowHeight}, rowsRect);
+			drawRect(list, stripe, stripeColor);
+		}
+		char rowText[256];
+		i32 rowTextLen = uiList->getRow(uiList->getRowData, row, rowText, sizeof(rowText));
+		drawText(list, font, rowText, rowTextLen, rowsRect.x + 4, rowY + textOffsetY, rowsRect, textColor);
+	}
+
+	SDL_Rect track, thumb;
+	uiListGetScrollbarRects(ui, winID, &track, &thumb);
+	SDL_Color trackColor = {.r = 30, .g = 30, .b = 30, .a = 255};
+	SDL_Color thumbColor = {.r = 100, .g = 100, .b = 100, .a = 255};
+	drawRect(list, track, trackColor);
+	drawRect(list, thumb, thumbColor);
+}
+
+// NOTE(khvorov) Tabs other than the one being drawn are dimmed
+void
+drawWindowTab(DrawList* list, UI* ui, Font* font, UIWindowID tabID, b32 active) {
+	SDL_Rect tabRect = ui->windows.tabRects[tabID];
+	SDL_Color tabColor = ui->windows.colors[tabID];
+	if (!active) {
+		tabColor.r /= 2;
+		tabColor.g /= 2;
+		tabColor.b /= 2;
+	}
+	drawRect(list, tabRect, tabColor);
+
+	UIWindowTitle* title = ui->windows.titles + tabID;
+	SDL_Color titleColor = {.r = 0, .g = 0, .b = 0, .a = 255};
+	i32 titleY = tabRect.y + (tabRect.h - font->lineHeight) / 2;
+	drawText(list, font, title->chars, title->len, tabRect.x + 4, titleY, tabRect, titleColor);
+}
+
+void
+drawWindow(DrawList* list, UI* ui, Font* font, UIWindowID winID) {
+	SDL_Rect winRect = uiGetWindowRect(ui, winID);
+	SDL_Color windowOutlineColor = {.r = 100, .g = 100, .b = 100, .a = 255};
+	drawRectOutline(list, winRect, windowOutlineColor, ui->windowBorderThickness);
+
+	UIWindowID ownerID = uiGetTabOwner(ui, winID);
+	if (ownerID >= 0) {
+		drawWindowTab(list, ui, font, ownerID, ownerID == winID);
+	}
+	for (UIWindowID childID = uiGetFirstDockChild(ui, ownerID); childID >= 0; childID = ui->windows.dockNextSiblings[childID]) {
+		if (ui->windows.dockPositions[childID] == DockPos_Center) {
+			drawWindowTab(list, ui, font, childID, childID == winID);
+		}
+	}
+
+	SDL_Rect contentRect = uiGetWindowContentRect(ui, winID);
+	SDL_Color contentRectBGColor = {.r = 0, .g = 0, .b = 0, .a = 255};
+	drawRect(list, contentRect, contentRectBGColor);
+
+	switch (ui->windows.contents[winID]) {
+	case UIWindowContent_None: break;
+	case UIWindowContent_Profiler: {drawProfilerGraph(list, font, contentRect);} break;
+	case UIWindowContent_List: {drawListView(list, ui, font, winID);} break;
+	}
+}
+
+b32
+colorsEqual(SDL_Color color1, SDL_Color color2) {
+	b32 result = color1.r == color2.r && color1.g == color2.g && color1.b == color2.b && color1.a == color2.a;
+	return result;
+}
+
+void
+drawListMerge(DrawList* list) {
+	list->batchCount = 0;
+	list->batches = arenaAlloc(list->arena, list->cmdCount * sizeof(*list->batches));
+	list->cmdBatches = arenaAlloc(list->arena, list->cmdCount * sizeof(*list->cmdBatches));
+	list->batchRects = arenaAlloc(list->arena, list->cmdCount * sizeof(*list->batchRects));
+	list->batchCmds = arenaAlloc(list->arena, list->cmdCount * sizeof(*list->batchCmds));
+
+	for (i32 cmdIndex = 0; cmdIndex < list->cmdCount; cmdIndex++) {
+		DrawCmd cmd = list->cmds[cmdIndex];
+
+		i32 batchIndex = -1;
+		i32 lookbackEnd = SDL_max(list->batchCount - DRAW_MERGE_LOOKBACK, 0);
+		for (i32 candidateIndex = list->batchCount - 1; candidateIndex >= lookbackEnd; candidateIndex--) {
+			DrawBatch* candidate = list->batches + candidateIndex;
+			if (candidate->kind == cmd.kind && (cmd.kind != DrawCmdKind_Rect || colorsEqual(candidate->color, cmd.color))) {
+				batchIndex = candidateIndex;
+				break;
+			}
+			if (rectsIntersect(candidate->bounds, cmd.rect)) {
+				break;
+			}
+		}
+
+		if (batchIndex == -1) {
+			batchIndex = list->batchCount++;
+			DrawBatch batch = {.kind = cmd.kind, .color = cmd.color, .bounds = cmd.rect};
+			list->batches[batchIndex] = batch;
+		} else {
+			DrawBatch* batch = list->batches + batchIndex;
+			batch->bounds = rectUnion(batch->bounds, cmd.rect);
+		}
+
+		list->batches[batchIndex].rectCount += 1;
+		list->cmdBatches[cmdIndex] = batchIndex;
+	}
+
+	// NOTE(khvorov) Lay out every batch's rects next to each other
+	i32 firstRect = 0;
+	i32 maxQuadCount = 0;
+	for (i32 batchIndex = 0; batchIndex < list->batchCount; batchIndex++) {
+		DrawBatch* batch = list->batches + batchIndex;
+		batch->firstRect = firstRect;
+		firstRect += batch->rectCount;
+		if (batch->kind == DrawCmdKind_Glyph) {
+			maxQuadCount = SDL_max(maxQuadCount, batch->rectCount);
+		}
+		batch->rectCount = 0;
+	}
+
+	for (i32 cmdIndex = 0; cmdIndex < list->cmdCount; cmdIndex++) {
+		DrawBatch* batch = list->batches + list->cmdBatches[cmdIndex];
+		list->batchRects[batch->firstRect + batch->rectCount] = list->cmds[cmdIndex].rect;
+		list->batchCmds[batch->firstRect + batch->rectCount] = cmdIndex;
+		batch->rectCount += 1;
+	}
+
+	// NOTE(khvorov) Quads are built once here and then submitted once per
+	// damage rect. Every quad uses the same index pattern.
+	list->vertices = arenaAlloc(list->arena, firstRect * 4 * sizeof(*list->vertices));
+	list->indices = arenaAlloc(list->arena, maxQuadCount * 6 * sizeof(*list->indices));
+	for (i32 quadIndex = 0; quadIndex < maxQuadCount; quadIndex++) {
+		i32* quadIndices = list->indices + quadIndex * 6;
+		i32 firstVertex = quadIndex * 4;
+		quadIndices[0] = firstVertex + 0;
+		quadIndices[1] = firstVertex + 1;
+		quadIndices[2] = firstVertex + 2;
+		quadIndices[3] = firstVertex + 2;
+		quadIndices[4] = firstVertex + 3;
+		quadIndices[5] = firstVertex + 0;
+	}
+
+	f32 uScale = 1.0f / (f32)GLYPH_ATLAS_DIM;
+	f32 vScale = 1.0f / (f32)GLYPH_ATLAS_DIM;
+	for (i32 batchIndex = 0; batchIndex < list->batchCount; batchIndex++) {
+		DrawBatch* batch = list->batches + batchIndex;
+		if (batch->kind == DrawCmdKind_Glyph) {
+
+			for (i32 quadIndex = 0; quadIndex < batch->rectCount; quadIndex++) {
+				DrawCmd* cmd = list->cmds + list->batchCmds[batch->firstRect + quadIndex];
+				f32 left = (f32)cmd->rect.x;
+				f32 top = (f32)cmd->rect.y;
+				f32 right = (f32)(cmd->rect.x + cmd->rect.w);
+				f32 bottom = (f32)(cmd->rect.y + cmd->rect.h);
+				f32 texLeft = (f32)cmd->texRect.x * uScale;
+				f32 texTop = (f32)cmd->texRect.y * vScale;
+				f32 texRight = (f32)(cmd->texRect.x + cmd->texRect.w) * uScale;
+				f32 texBottom = (f32)(cmd->texRect.y + cmd->texRect.h) * vScale;
+
+				SDL_Vertex* quad = list->vertices + (batch->firstRect + quadIndex) * 4;
+				quad[0] = (SDL_Vertex) {.position = {left, top}, .color = cmd->color, .tex_coord = {texLeft, texTop}};
+				quad[1] = (SDL_Vertex) {.position = {right, top}, .color = cmd->color, .tex_coord = {texRight, texTop}};
+				quad[2] = (SDL_Vertex) {.position = {right, bottom}, .color = cmd->color, .tex_coord = {texRight, texBottom}};
+				quad[3] = (SDL_Vertex) {.position = {left, bottom}, .color = cmd->color, .tex_coord = {texLeft, texBottom}};
+			}
+		}
+	}
+}
+
+// NOTE(khvorov) Rects are batched here so that each batch is one
+// SDL_RenderFillRects call. SDL is built without libc, so it has no alloca and
+// that call still mallocs its scaled copy of the rects once. The tile path
+// doesn't go through the renderer and doesn't allocate.
+void
+drawListSubmit(DrawList* list, SDL_Renderer* sdlRenderer, SDL_Rect clipRect, SDL_Texture* atlas, WindowCache* windowCaches) {
+	SDL_RenderSetClipRect(sdlRenderer, &clipRect);
+	for (i32 batchIndex = 0; batchIndex < list->batchCount; batchIndex++) {
+		DrawBatch* batch = list->batches + batchIndex;
+		if (rectsIntersect(batch->bounds, clipRect)) {
+			switch (batch->kind) {
+			case DrawCmdKind_Rect: {
+				SDL_SetRenderDrawColor(sdlRenderer, batch->color.r, batch->color.g, batch->color.b, batch->color.a);
+				SDL_RenderFillRects(sdlRenderer, list->batchRects + batch->firstRect, batch->rectCount);
+			} break;
+
+			case DrawCmdKind_Glyph: {
+				SDL_RenderGeometry(
+					sdlRenderer, atlas, list->vertices + batch->firstRect * 4, batch->rectCount * 4,
+					list->indices, batch->rectCount * 6
+				);
+			} break;
+
+			case DrawCmdKind_Image: {
+				for (i32 imageIndex = 0; imageIndex < batch->rectCount; imageIndex++) {
+					DrawCmd* cmd = list->cmds + list->batchCmds[batch->firstRect + imageIndex];
+					SDL_Texture* texture = windowCaches[cmd->window].texture;
+					if (texture && rectsIntersect(cmd->rect, clipRect)) {
+						SDL_RenderCopy(sdlRenderer, texture, &cmd->texRect, &cmd->rect);
+					}
+				}
+			} break;
+			}
+		}
+	}
+	SDL_RenderSetClipRect(sdlRenderer, 0);
+}
+
+#if SCAN_X86
+SCAN_TARGET_SSE2 void
+rasterFillRowSSE2(u32* dest, u32 pixel, i32 count) {
+	__m128i pixels = _mm_set1_epi32((int)pixel);
+	i32 index = 0;
+	for (; index + 16 <= count; index += 16) {
+		_mm_storeu_si128((__m128i*)(dest + index), pixels);
+		_mm_storeu_si128((__m128i*)(dest + index + 4), pixels);
+		_mm_storeu_si128((__m128i*)(dest + index + 8), pixels);
+		_mm_storeu_si128((__m128i*)(dest + index + 12), pixels);
+	}
+	for (; index + 4 <= count; index += 4) {
+		_mm_storeu_si128((__m128i*)(dest + index), pixels);
+	}
+	for (; index < count; index++) {
+		dest[index] = pixel;
+	}
+}
+#endif
+
+// NOTE(khvorov) SDL_memset4 is a plain loop outside of 32 bit x86
+void
+rasterFillRow(RasterPool* pool, u32* dest, u32 pixel, i32 count) {
+#if SCAN_X86
+	if (pool->hasSSE2) {
+		rasterFillRowSSE2(dest, pixel, count);
+	} else {
+		SDL_memset4(dest, pixel, (size_t)count);
+	}
+#else
+	SDL_memset4(dest, pixel, (size_t)count);
+#endif
+}
+
+// NOTE(khvorov) Same results as the software renderer: rects overwrite, glyphs
+// blend the way SDL blends a color modulated texture, images are copied
+void
+rasterDrawCmd(RasterPool* pool, RasterTarget* target, DrawCmd* cmd, SDL_Rect rect) {
+	switch (cmd->kind) {
+	case DrawCmdKind_Rect: {
+		u32 pixel = ((u32)cmd->color.r << 16) | ((u32)cmd->color.g << 8) | (u32)cmd->color.b;
+		for (i32 row = rect.y; row < rect.y + rect.h; row++) {
+			rasterFillRow(pool, target->pixels + row * target->pitch + rect.x, pixel, rect.w);
+		}
+	} break;
+
+	case DrawCmdKind_Glyph: {
+		u32 colorR = cmd->color.r;
+		u32 colorG = cmd->color.g;
+		u32 colorB = cmd->color.b;
+		u32 colorA = cmd->color.a;
+		for (i32 row = 0; row < rect.h; row++) {
+			i32 texY = cmd->texRect.y + rect.y - cmd->rect.y + row;
+			u8* coverage = pool->glyphCoverage + texY * GLYPH_ATLAS_DIM + cmd->texRect.x + rect.x - cmd->rect.x;
+			u32* dest = target->pixels + (rect.y + row) * target->pitch + rect.x;
+			for (i32 col = 0; col < rect.w; col++) {
+				u32 alpha = colorA == 255 ? coverage[col] : coverage[col] * colorA / 255;
+				if (alpha > 0) {
+					u32 destPixel = dest[col];
+					u32 destR = (destPixel >> 16) & 0xFF;
+					u32 destG = (destPixel >> 8) & 0xFF;
+					u32 destB = destPixel & 0xFF;
+					destR = colorR * alpha / 255 + (255 - alpha) * destR / 255;
+					destG = colorG * alpha / 255 + (255 - alpha) * destG / 255;
+					destB = colorB * alpha / 255 + (255 - alpha) * destB / 255;
+					dest[col] = (destR << 16) | (destG << 8) | destB;
+				}
+			}
+		}
+	} break;
+
+	case DrawCmdKind_Image: {
+		WindowCache* cache = pool->windowCaches + cmd->window;
+		if (cache->pixels) {
+			i32 texX = cmd->texRect.x + rect.x - cmd->rect.x;
+			i32 texY = cmd->texRect.y + rect.y - cmd->rect.y;
+			for (i32 row = 0; row < rect.h; row++) {
+				u32* src = cache->pixels + (texY + row) * cache->texWidth + texX;
+				SDL_memcpy(target->pixels + (rect.y + row) * target->pitch + rect.x, src, rect.w * sizeof(u32));
+			}
+		}
+	} break;
+	}
+}
+
+void
+rasterDrawTile(RasterPool* pool, RasterTile* tile) {
+	for (i32 rectIndex = 0; rectIndex < tile->rectCount; rectIndex++) {
+		SDL_Rect clip = rectIntersect(tile->rect, tile->rects[rectIndex]);
+		if (rectArea(clip) > 0) {
+			for (i32 cmdIndex = 0; cmdIndex < tile->cmdCount; cmdIndex++) {
+				DrawCmd* cmd = tile->list->cmds + tile->cmds[cmdIndex];
+				SDL_Rect rect = rectIntersect(cmd->rect, clip);
+				if (rectArea(rect) > 0) {
+					rasterDrawCmd(pool, &tile->target, cmd, rect);
+				}
+			}
+		}
+	}
+}
+
+void
+rasterDrawTiles(RasterPool* pool) {
+	for (;;) {
+		i32 tileIndex = SDL_AtomicAdd(&pool->nextTile, 1);
+		if (tileIndex >= pool->tileCount) {
+			break;
+		}
+		rasterDrawTile(pool, pool->tiles + tileIndex);
+	}
+}
+
+int
+rasterWorkerMain(void* data) {
+	RasterPool* pool = (RasterPool*)data;
+	for (;;) {
+		SDL_SemWait(pool->start);
+		if (SDL_AtomicGet(&pool->quit)) {
+			break;
+		}
+		rasterDrawTiles(pool);
+		SDL_SemPost(pool->done);
+	}
+	return 0;
+}
+
+// NOTE(khvorov) Leaves a core for the ui thread, the render thread makes up the difference
+void
+rasterPoolInit(RasterPool* pool, i32 workerCap) {
+	SDL_memset(pool, 0, sizeof(RasterPool));
+	arenaInit(&pool->arena, "raster", (size_t)256 * 1024 * 1024);
+	pool->start = SDL_CreateSemaphore(0);
+	pool->done = SDL_CreateSemaphore(0);
+	i32 workerCount = SDL_min(SDL_GetCPUCount() - 1, SDL_min(workerCap, RASTER_WORKERS_MAX));
+	for (i32 workerIndex = 0; workerIndex < workerCount && pool->start && pool->done; workerIndex++) {
+		SDL_Thread* thread = SDL_CreateThread(rasterWorkerMain, "raster worker", pool);
+		if (thread) {
+			pool->workers[pool->workerCount++] = thread;
+		}
+	}
+	pool->activeWorkerCount = pool->workerCount;
+	pool->hasSSE2 = SDL_HasSSE2();
+	pool->enabled = true;
+}
+
+void
+rasterPoolDeinit(RasterPool* pool) {
+	SDL_AtomicSet(&pool->quit, 1);
+	for (i32 workerIndex = 0; workerIndex < pool->workerCount; workerIndex++) {
+		SDL_SemPost(pool->start);
+	}
+	for (i32 workerIndex = 0; workerIndex < pool->workerCount; workerIndex++) {
+		SDL_WaitThread(pool->workers[workerIndex], 0);
+	}
+	if (pool->start) {
+		SDL_DestroySemaphore(pool->start);
+	}
+	if (pool->done) {
+		SDL_DestroySemaphore(pool->done);
+	}
+	arenaRelease(&pool->arena);
+	SDL_memset(pool, 0, sizeof(RasterPool));
+}
+
+void
+rasterBegin(RasterPool* pool) {
+	arenaReset(&pool->arena);
+	pool->tileCap = 0;
+	pool->tileCount = 0;
+	pool->tiles = 0;
+}
+
+// NOTE(khvorov) Bins the commands into the tiles the rects touch. Counts
+// first so that every tile's commands end up next to each other in one array.
+void
+rasterAddList(RasterPool* pool, RasterTarget target, DrawList* list, SDL_Rect* rects, i32 rectCount) {
+	SDL_Rect targetRect = {.x = 0, .y = 0, .w = target.width, .h = target.height};
+	SDL_Rect bounds = {0};
+	for (i32 rectIndex = 0; rectIndex < rectCount; rectIndex++) {
+		SDL_Rect rect = rectIntersect(rects[rectIndex], targetRect);
+		if (rectArea(rect) > 0) {
+			bounds = rectArea(bounds) > 0 ? rectUnion(bounds, rect) : rect;
+		}
+	}
+
+	if (rectArea(bounds) > 0) {
+		i32 firstTileX = bounds.x / RASTER_TILE_WIDTH;
+		i32 firstTileY = bounds.y / RASTER_TILE_HEIGHT;
+		i32 tilesX = (bounds.x + bounds.w - 1) / RASTER_TILE_WIDTH - firstTileX + 1;
+		i32 tilesY = (bounds.y + bounds.h - 1) / RASTER_TILE_HEIGHT - firstTileY + 1;
+		i32 binCount = tilesX * tilesY;
+		i32* binStarts = arenaAlloc(&pool->arena, (binCount + 1) * sizeof(i32));
+		i32* binCursors = arenaAlloc(&pool->arena, binCount * sizeof(i32));
+		SDL_memset(binCursors, 0, binCount * sizeof(i32));
+
+		for (i32 cmdIndex = 0; cmdIndex < list->cmdCount; cmdIndex++) {
+			SDL_Rect rect = rectIntersect(list->cmds[cmdIndex].rect, bounds);
+			if (rectArea(rect) > 0) {
+				for (i32 tileY = rect.y / RASTER_TILE_HEIGHT; tileY <= (rect.y + rect.h - 1) / RASTER_TILE_HEIGHT; tileY++) {
+					for (i32 tileX = rect.x / RASTER_TILE_WIDTH; tileX <= (rect.x + rect.w - 1) / RASTER_TILE_WIDTH; tileX++) {
+						binCursors[(tileY - firstTileY) * tilesX + tileX - firstTileX] += 1;
+					}
+				}
+			}
+		}
+
+		binStarts[0] = 0;
+		for (i32 binIndex = 0; binIndex < binCount; binIndex++) {
+			binStarts[binIndex + 1] = binStarts[binIndex] + binCursors[binIndex];
+			binCursors[binIndex] = binStarts[binIndex];
+		}
+
+		i32* binCmds = arenaAlloc(&pool->arena, SDL_max(binStarts[binCount], 1) * sizeof(i32));
+		for (i32 cmdIndex = 0; cmdIndex < list->cmdCount; cmdIndex++) {
+			SDL_Rect rect = rectIntersect(list->cmds[cmdIndex].rect, bounds);
+			if (rectArea(rect) > 0) {
+				for (i32 tileY = rect.y / RASTER_TILE_HEIGHT; tileY <= (rect.y + rect.h - 1) / RASTER_TILE_HEIGHT; tileY++) {
+					for (i32 tileX = rect.x / RASTER_TILE_WIDTH; tileX <= (rect.x + rect.w - 1) / RASTER_TILE_WIDTH; tileX++) {
+						binCmds[binCursors[(tileY - firstTileY) * tilesX + tileX - firstTileX]++] = cmdIndex;
+					}
+				}
+			}
+		}
+
+		if (pool->tileCount + binCount > pool->tileCap) {
+			i32 newCap = SDL_max(pool->tileCap * 2, pool->tileCount + binCount);
+			pool->tiles = arenaGrowArray(&pool->arena, pool->tiles, pool->tileCap, newCap, sizeof(RasterTile));
+			pool->tileCap = newCap;
+		}
+
+		for (i32 binIndex = 0; binIndex < binCount; binIndex++) {
+			SDL_Rect tileRect = {
+				.x = (firstTileX + binIndex % tilesX) * RASTER_TILE_WIDTH, .y = (firstTileY + binIndex / tilesX) * RASTER_TILE_HEIGHT,
+				.w = RASTER_TILE_WIDTH, .h = RASTER_TILE_HEIGHT,
+			};
+			tileRect = rectIntersect(tileRect, bounds);
+			b32 damaged = false;
+			for (i32 rectIndex = 0; rectIndex < rectCount && !damaged; rectIndex++) {
+				damaged = rectsIntersect(tileRect, rects[rectIndex]);
+			}
+			i32 cmdCount = binStarts[binIndex + 1] - binStarts[binIndex];
+			if (damaged && cmdCount > 0) {
+				RasterTile* tile = pool->tiles + pool->tileCount++;
+				tile->target = target;
+				tile->list = list;
+				tile->rect = tileRect;
+				tile->rects = rects;
+				tile->rectCount = rectCount;
+				tile->cmds = binCmds + binStarts[binIndex];
+				tile->cmdCount = cmdCount;
+			}
+		}
+	}
+}
+
+// NOTE(khvorov) Returns once every tile added since rasterBegin is drawn. Workers
+// that would have nothing to do are left asleep.
+void
+rasterRun(RasterPool* pool) {
+	SDL_AtomicSet(&pool->nextTile, 0);
+	i32 helperCount = SDL_max(SDL_min(pool->activeWorkerCount, pool->tileCount - 1), 0);
+	for (i32 helperIndex = 0; helperIndex < helperCount; helperIndex++) {
+		SDL_SemPost(pool->start);
+	}
+	rasterDrawTiles(pool);
+	for (i32 helperIndex = 0; helperIndex < helperCount; helperIndex++) {
+		SDL_SemWait(pool->done);
+	}
+}
+
+// NOTE(khvorov) SDL stamps events with the millisecond tick count. How long ago
+// that was is taken off the performance counter so that the stamp can be
+// compared with present times.
+void
+inputStampEvent(Input* input, u32 eventTimestamp) {
+	if (input->eventTime == 0) {
+		u64 now = SDL_GetPerformanceCounter();
+		u64 age = (u64)((u32)SDL_GetTicks() - eventTimestamp) * SDL_GetPerformanceFrequency() / 1000;
+		input->eventTime = now - SDL_min(age, now - 1);
+	}
+}
+
+// NOTE(khvorov) Torn off windows report the cursor relative to themselves and
+// the ui wants everything relative to the main window
+void
+inputSetCursor(Input* input, SDL_Window* window, u32 eventWindowID, i32 x, i32 y) {
+	input->cursorX = x;
+	input->cursorY = y;
+	input->cursorWindowID = eventWindowID;
+	SDL_Window* eventWindow = eventWindowID ? SDL_GetWindowFromID(eventWindowID) : 0;
+	if (eventWindow && eventWindow != window) {
+		i32 mainX, mainY, eventX, eventY;
+		SDL_GetWindowPosition(window, &mainX, &mainY);
+		SDL_GetWindowPosition(eventWindow, &eventX, &eventY);
+		input->cursorX += eventX - mainX;
+		input->cursorY += eventY - mainY;
+	}
+}
+
+// NOTE(khvorov) Motion only overwrites the cursor position so any number of
+// motion events collapse into one frame. A button transition has to be seen
+// at the position it happened at, so it ends the batch of events for this
+// frame and whatever comes after it waits for the next one.
+b32
+processEvent(SDL_Window* window, SDL_Event* event, b32* running, b32* redrawAll, Input* input) {
+
+	b32 endsBatch = false;
+	switch (event->type) {
+	case SDL_QUIT: {*running = false;} break;
+
+	// NOTE(khvorov) Torn off windows are redrawn along with the main one, they
+	// are closed by docking them back
+	case SDL_WINDOWEVENT: {
+		b32 isMain = event->window.windowID == SDL_GetWindowID(window);
+		switch (event->window.event) {
+		case SDL_WINDOWEVENT_CLOSE: {
+			if (isMain) {
+				*running = false;
+			}
+		} break;
+		// NOTE(khvorov) Window surface contents are not reliable after these
+		case SDL_WINDOWEVENT_EXPOSED: case SDL_WINDOWEVENT_SIZE_CHANGED: case SDL_WINDOWEVENT_RESTORED: {*redrawAll = true;} break;
+		}
+	} break;
+
+	case SDL_MOUSEMOTION: {
+		inputSetCursor(input, window, event->motion.windowID, event->motion.x, event->motion.y);
+		inputStampEvent(input, event->motion.timestamp);
+	} break;
+
+	case SDL_KEYDOWN: case SDL_KEYUP: {
+		if (!event->key.repeat) {
+			b32 down = event->type == SDL_KEYUP ? 0 : 1;
+			InputKeyID keyID = InputKeyID_Count;
+			switch (event->key.keysym.scancode) {
+			case SDL_SCANCODE_F1: {keyID = InputKeyID_F1;} break;
+			case SDL_SCANCODE_F2: {keyID = InputKeyID_F2;} break;
+			case SDL_SCANCODE_F3: {keyID = InputKeyID_F3;} break;
+			case SDL_SCANCODE_RETURN: case SDL_SCANCODE_KP_ENTER: {keyID = InputKeyID_Enter;} break;
+			case SDL_SCANCODE_BACKSPACE: {keyID = InputKeyID_Backspace;} break;
+			case SDL_SCANCODE_ESCAPE: {keyID = InputKeyID_Escape;} break;
+			default: break;
+			}
+			if (keyID != InputKeyID_Count) {
+				recordKey(input, keyID, down);
+				inputStampEvent(input, event->key.timestamp);
+			}
+		}
+	} break;
+
+	case SDL_TEXTINPUT: {
+		for (char* ch = event->text.text; *ch && input->textLen < INPUT_TEXT_CAP; ch++) {
+			if ((u8)*ch < 0x80) {
+				input->text[input->textLen++] = *ch;
+			}
+		}
+		inputStampEvent(input, event->text.timestamp);
+	} break;
+
+	case SDL_MOUSEWHEEL: {
+		f32 scrollY = event->wheel.preciseY;
+		if (event->wheel.direction == SDL_MOUSEWHEEL_FLIPPED) {
+			scrollY = -scrollY;
+		}
+		input->scrollY += scrollY;
+		inputStampEvent(input, event->wheel.timestamp);
+	} break;
+
+	case SDL_MOUSEBUTTONDOWN: case SDL_MOUSEBUTTONUP: {
+		b32 down = event->type == SDL_MOUSEBUTTONUP ? 0 : 1;
+		InputKeyID keyID = InputKeyID_Count;
+		switch (event->button.button) {
+		case SDL_BUTTON_LEFT: {keyID = InputKeyID_MouseLeft;} break;
+		}
+		if (keyID != InputKeyID_Count) {
+			inputSetCursor(input, window, event->button.windowID, event->button.x, event->button.y);
+			recordKey(input, keyID, down);
+			inputStampEvent(input, event->button.timestamp);
+			endsBatch = true;
+		}
+	}
+	}
+
+	return endsBatch;
+}
+
+b32
+pollEvents(SDL_Window* window, b32* running, b32* redrawAll, Input* input) {
+	b32 endsBatch = false;
+	SDL_Event event;
+	while (!endsBatch && SDL_PollEvent(&event)) {
+		endsBatch = processEvent(window, &event, running, redrawAll, input);
+	}
+	return endsBatch;
+}
+
+// NOTE(khvorov) The software renderer doesn't wait for vblank so without
+// this a fast mouse would get a frame per motion event. Frames are spaced
+// at least a refresh interval apart and start as late as the measured
+// frame cost allows so that they carry the freshest cursor position. The
+// cost runs from the start of a frame on the ui thread to its present, which
+// is back on the ui thread.
+typedef struct FramePacer {
+	f64 refreshSeconds;
+	SDL_SpinLock lock;
+	f64 frameCostSeconds;
+	u64 lastPresent;
+} FramePacer;
+
+void
+pacerSetRefreshRate(FramePacer* pacer, SDL_Window* window) {
+	SDL_DisplayMode mode;
+	i32 refreshRate = 60;
+	i32 displayIndex = SDL_GetWindowDisplayIndex(window);
+	if (displayIndex >= 0 && SDL_GetCurrentDisplayMode(displayIndex, &mode) == 0 && mode.refresh_rate > 0) {
+		refreshRate = mode.refresh_rate;
+	}
+	pacer->refreshSeconds = 1.0 / (f64)refreshRate;
+}
+
+f64
+pacerGetFrameCost(FramePacer* pacer) {
+	SDL_AtomicLock(&pacer->lock);
+	f64 result = pacer->frameCostSeconds;
+	SDL_AtomicUnlock(&pacer->lock);
+	return result;
+}
+
+i32
+pacerGetWaitMs(FramePacer* pacer) {
+	f64 margin = 0.001;
+	SDL_AtomicLock(&pacer->lock);
+	f64 frameCost = pacer->frameCostSeconds;
+	u64 lastPresent = pacer->lastPresent;
+	SDL_AtomicUnlock(&pacer->lock);
+	f64 sinceLastPresent = (f64)(SDL_GetPerformanceCounter() - lastPresent) / (f64)SDL_GetPerformanceFrequency();
+	f64 untilStart = pacer->refreshSeconds - frameCost - margin - sinceLastPresent;
+	i32 result = (i32)(untilStart * 1000.0);
+	return result;
+}
+
+// NOTE(khvorov) Called right after the present returns. Time spent holding the
+// present for a refresh boundary is not part of what the frame costs.
+void
+pacerRecordPresent(FramePacer* pacer, u64 frameStart, u64 heldTicks) {
+	u64 now = SDL_GetPerformanceCounter();
+	f64 frameCost = (f64)(now - frameStart - heldTicks) / (f64)SDL_GetPerformanceFrequency();
+	SDL_AtomicLock(&pacer->lock);
+	pacer->frameCostSeconds = pacer->frameCostSeconds * 0.9 + frameCost * 0.1;
+	pacer->lastPresent = now;
+	SDL_AtomicUnlock(&pacer->lock);
+}
+
+// NOTE(khvorov) Picks how frames get to the screen of the main window, torn
+// off windows present as soon as they're drawn. Immediate starts a frame for
+// every batch of input and presents it as soon as it's drawn. Capped is the
+// frame pacer. Spaced is the render thread holding each frame back from the
+// present until the next refresh interval boundary, counted from the first
+// such present, so frames come evenly spaced but not lined up with the display.
+// There is no vsync mode because there is nothing to turn on. The software
+// renderer is the only one we build and it has no SetVSync, so
+// SDL_RenderSetVSync on it only ever returns unsupported. It doesn't present to
+// the window either, we read its pixels back into the canvas. What does reach
+// the window is SDL_UpdateWindowSurfaceRects, which on windows is a BitBlt
+// from a dib section with no vblank to wait on and no flag to ask for one.
+// Spaced is as close as that gets.
+#define PRESENT_ANIMATING_MS 250 // NOTE(khvorov) How long after the last frame without input the app counts as animating
+
+typedef struct PresentPolicy {
+	SDL_atomic_t mode;
+	SDL_atomic_t refreshMicros;
+	SDL_atomic_t renderMicros; // NOTE(khvorov) Render plus present, averaged
+	SDL_atomic_t presentMicros; // NOTE(khvorov) Time blocked in present, averaged
+	PresentReason reason;
+	u32 lastAnimatedTicks;
+
+	// NOTE(khvorov) The ui thread presents and keeps these two
+	f64 renderSeconds;
+	f64 presentSeconds;
+	u64 nextSlot; // NOTE(khvorov) Render thread only
+} PresentPolicy;
+
+// NOTE(khvorov) Waits to the millisecond, the rest is not worth spinning for.
+// Returns how long it waited.
+u64
+presentPolicyWaitForSlot(PresentPolicy* policy) {
+	u64 result = 0;
+	u64 frequency = SDL_GetPerformanceFrequency();
+	u64 interval = (u64)SDL_AtomicGet(&policy->refreshMicros) * frequency / 1000000;
+	if (SDL_AtomicGet(&policy->mode) == PresentMode_Spaced && interval > 0) {
+		u64 now = SDL_GetPerformanceCounter();
+		if (policy->nextSlot == 0) {
+			policy->nextSlot = now;
+		} else if (policy->nextSlot < now) {
+			policy->nextSlot += ((now - policy->nextSlot) / interval + 1) * interval;
+		}
+
+		ProfileZone waitZone = profileBegin(ProfileZoneKind_PaceWait);
+		u32 waitMs = (u32)((policy->nextSlot - now) * 1000 / frequency);
+		if (waitMs > 0) {
+			SDL_Delay(waitMs);
+		}
+		profileEnd(waitZone);
+		policy->nextSlot += interval;
+		result = SDL_GetPerformanceCounter() - now;
+	}
+	return result;
+}
+
+void
+presentPolicyRecordPresent(PresentPolicy* policy, u64 renderTicks, u64 presentStart) {
+	f64 frequency = (f64)SDL_GetPerformanceFrequency();
+	f64 presentSeconds = (f64)(SDL_GetPerformanceCounter() - presentStart) / frequency;
+	policy->renderSeconds = policy->renderSeconds * 0.9 + ((f64)renderTicks / frequency + presentSeconds) * 0.1;
+	policy->presentSeconds = policy->presentSeconds * 0.9 + presentSeconds * 0.1;
+	SDL_AtomicSet(&policy->renderMicros, (int)(policy->renderSeconds * 1000000.0));
+	SDL_AtomicSet(&policy->presentMicros, (int)(policy->presentSeconds * 1000000.0));
+}
+
+// NOTE(khvorov) Dragging wants the freshest cursor position so frames start
+// as late as the pacer allows, unless they take longer than a refresh, then
+// waiting only adds to the lag. Animating wants frames evenly spaced, unless
+// present already blocks for a good part of a refresh, then the platform is
+// syncing on its own and the pacer is enough. Otherwise input is shown as
+// soon as it's drawn.
+void
+presentPolicyChoose(PresentPolicy* policy, FramePacer* pacer, b32 dragging, b32 animated) {
+	u32 ticks = SDL_GetTicks();
+	if (animated) {
+		policy->lastAnimatedTicks = ticks;
+	}
+	b32 animating = policy->lastAnimatedTicks != 0 && ticks - policy->lastAnimatedTicks < PRESENT_ANIMATING_MS;
+
+	i32 refreshMicros = (i32)(pacer->refreshSeconds * 1000000.0);
+	SDL_AtomicSet(&policy->refreshMicros, refreshMicros);
+	i32 frameMicros = SDL_max((i32)(pacerGetFrameCost(pacer) * 1000000.0), SDL_AtomicGet(&policy->renderMicros));
+	i32 presentMicros = SDL_AtomicGet(&policy->presentMicros);
+
+	PresentMode mode = PresentMode_Immediate;
+	PresentReason reason = PresentReason_Idle;
+	if (dragging && frameMicros > refreshMicros) {
+		reason = PresentReason_DraggingSlowFrames;
+	} else if (dragging) {
+		mode = PresentMode_Capped;
+		reason = PresentReason_Dragging;
+	} else if (animating && presentMicros > refreshMicros / 2) {
+		mode = PresentMode_Capped;
+		reason = PresentReason_AnimatingPresentBlocks;
+	} else if (animating) {
+		mode = PresentMode_Spaced;
+		reason = PresentReason_Animating;
+	}
+
+	if (mode != (PresentMode)SDL_AtomicGet(&policy->mode) || reason != policy->reason) {
+		SDL_AtomicSet(&policy->mode, mode);
+		policy->reason = reason;
+		profileSetPresentMode(mode, reason);
+		SDL_LogDebug(
+			SDL_LOG_CATEGORY_RENDER, "present mode: %s, %s, frame %.2fms, present %.2fms",
+			presentGetModeName(mode), presentGetReasonName(reason), (f64)frameMicros / 1000.0, (f64)presentMicros / 1000.0
+		);
+	}
+}
+
+// NOTE(khvorov) A recording is a header followed by one fixed-size record per
+// frame: cursor position, viewport size, wheel scroll and a byte per key
+// holding the half-transition count and the ended-down bit. Everything is
+// little endian.
+#define INPUT_RECORDING_MAGIC 0x52494457 // NOTE(khvorov) "WDIR"
+#define INPUT_RECORDING_VERSION 3
+
+SDL_RWops*
+inputRecordingOpenWrite(char* path) {
+	SDL_RWops* file = SDL_RWFromFile(path, "wb");
+	if (file) {
+		SDL_WriteLE32(file, INPUT_RECORDING_MAGIC);
+		SDL_WriteLE16(file, INPUT_RECORDING_VERSION);
+		SDL_WriteLE16(file, InputKeyID_Count);
+	} else {
+		SDL_Log("recording: could not open %s: %s", path, SDL_GetError());
+	}
+	return file;
+}
+
+SDL_RWops*
+inputRecordingOpenRead(char* path) {
+	SDL_RWops* file = SDL_RWFromFile(path, "rb");
+	if (file) {
+		u32 magic = SDL_ReadLE32(file);
+		u32 version = SDL_ReadLE16(file);
+		u32 keyCount = SDL_ReadLE16(file);
+		if (magic != INPUT_RECORDING_MAGIC || version != INPUT_RECORDING_VERSION || keyCount != InputKeyID_Count) {
+			SDL_Log("recording: %s is not a recording this build can replay", path);
+			SDL_RWclose(file);
+			file = 0;
+		}
+	} else {
+		SDL_Log("recording: could not open %s: %s", path, SDL_GetError());
+	}
+	return file;
+}
+
+void
+inputRecordingWriteFrame(SDL_RWops* file, Input* input, i32 width, i32 height) {
+	SDL_WriteLE32(file, (u32)input->cursorX);
+	SDL_WriteLE32(file, (u32)input->cursorY);
+	SDL_WriteLE16(file, (Uint16)width);
+	SDL_WriteLE16(file, (Uint16)height);
+	u32 scrollBits = 0;
+	SDL_memcpy(&scrollBits, &input->scrollY, sizeof(scrollBits));
+	SDL_WriteLE32(file, scrollBits);
+	SDL_WriteU8(file, (Uint8)input->textLen);
+	SDL_RWwrite(file, input->text, INPUT_TEXT_CAP, 1);
+	for (InputKeyID keyID = 0; keyID < InputKeyID_Count; keyID++) {
+		InputKey* key = input->keys + keyID;
+		u32 halfTransitionCount = (u32)SDL_min(key->halfTransitionCount, 127);
+		SDL_WriteU8(file, (Uint8)((halfTransitionCount << 1) | (key->endedDown ? 1 : 0)));
+	}
+}
+
+// NOTE(khvorov) Fields in a record are not aligned
+u32
+inputRecordingGetU32(u8* record, i32 offset) {
+	u32 value = 0;
+	SDL_memcpy(&value, record + offset, sizeof(value));
+	u32 result = SDL_SwapLE32(value);
+	return result;
+}
+
+Uint16
+inputRecordingGetU16(u8* record, i32 offset) {
+	Uint16 value = 0;
+	SDL_memcpy(&value, record + offset, sizeof(value));
+	Uint16 result = SDL_SwapLE16(value);
+	return result;
+}
+
+b32
+inputRecordingReadFrame(SDL_RWops* file, Input* input, i32* width, i32* height) {
+	u8 record[17 + INPUT_TEXT_CAP + InputKeyID_Count];
+	b32 result = SDL_RWread(file, record, sizeof(record), 1) == 1;
+	if (result) {
+		input->cursorX = (i32)inputRecordingGetU32(record, 0);
+		input->cursorY = (i32)inputRecordingGetU32(record, 4);
+		*width = inputRecordingGetU16(record, 8);
+		*height = inputRecordingGetU16(record, 10);
+		u32 scrollBits = inputRecordingGetU32(record, 12);
+		SDL_memcpy(&input->scrollY, &scrollBits, sizeof(scrollBits));
+		input->textLen = SDL_min(record[16], INPUT_TEXT_CAP);
+		SDL_memcpy(input->text, record + 17, INPUT_TEXT_CAP);
+		for (InputKeyID keyID = 0; keyID < InputKeyID_Count; keyID++) {
+			u8 packed = record[17 + INPUT_TEXT_CAP + keyID];
+			input->keys[keyID].halfTransitionCount = packed >> 1;
+			input->keys[keyID].endedDown = packed & 1;
+		}
+	}
+	return result;
+}
+
+int
+compareF64(const void* left, const void* right) {
+	f64 leftValue = *(const f64*)left;
+	f64 rightValue = *(const f64*)right;
+	int result = leftValue < rightValue ? -1 : (leftValue > rightValue ? 1 : 0);
+	return result;
+}
+
+ScanQuery
+scanQueryBytes(char* bytes) {
+	ScanQuery result = {.match = ScanMatch_Bytes};
+	for (char* ch = bytes; *ch && result.byteCount < SCAN_QUERY_BYTES_MAX; ch++) {
+		result.bytes[result.byteCount++] = (u8)*ch;
+	}
+	return result;
+}
+
+ScanQuery
+scanQueryUtf8Starts(void) {
+	ScanQuery result = {.match = ScanMatch_Utf8Start};
+	return result;
+}
+
+char*
+scanGetKernelName(ScanKernel kernel) {
+	char* result = "";
+	switch (kernel) {
+	case ScanKernel_Scalar: {result = "scalar";} break;
+	case ScanKernel_SSE2: {result = "sse2";} break;
+	case ScanKernel_AVX2: {result = "avx2";} break;
+	case ScanKernel_Count: break;
+	}
+	return result;
+}
+
+ScanKernel
+scanGetBestKernel(void) {
+	ScanKernel result = ScanKernel_Scalar;
+#if SCAN_X86
+	if (SDL_HasAVX2()) {
+		result = ScanKernel_AVX2;
+	} else if (SDL_HasSSE2()) {
+		result = ScanKernel_SSE2;
+	}
+#endif
+	return result;
+}
+
+i32
+scanCountTrailingZeros(u32 mask) {
+#ifdef _MSC_VER
+	unsigned long result = 0;
+	_BitScanForward(&result, mask);
+#else
+	i32 result = __builtin_ctz(mask);
+#endif
+	return (i32)result;
+}
+
+// NOTE(khvorov) Byte at a time from offset. Also finishes off whatever the
+// vector kernels leave at the end.
+i32
+scanTail(ScanQuery* query, u8* data, i32 offset, i32 size, u32* out, i32 count, i32 outCap, i32* scanned) {
+	if (query->match == ScanMatch_Utf8Start) {
+		for (; offset < size && count < outCap; offset++) {
+			if ((data[offset] & 0xC0) != 0x80) {
+				out[count++] = (u32)offset;
+			}
+		}
+	} else {
+		for (; offset < size && count < outCap; offset++) {
+			u8 byte = data[offset];
+			for (i32 byteIndex = 0; byteIndex < query->byteCount; byteIndex++) {
+				if (byte == query->bytes[byteIndex]) {
+					out[count++] = (u32)offset;
+					break;
+				}
+			}
+		}
+	}
+	*scanned = offset;
+	return count;
+}
+
+// NOTE(khvorov) Each of the kernels writes the offsets of the bytes in
+// data[0, size) that match the query to out and returns how many it wrote.
+// They stop early once out is full, scanned says how far they got. The
+// vector ones turn a block into a bit mask and walk its set bits, except
+// when every byte matched, which is the usual case for utf8 starts.
+i32
+scanScalar(ScanQuery* query, u8* data, i32 size, u32* out, i32 outCap, i32* scanned) {
+	i32 result = scanTail(query, data, 0, size, out, 0, outCap, scanned);
+	return result;
+}
+
+#if SCAN_X86
+
+SCAN_TARGET_SSE2 i32
+scanSSE2(ScanQuery* query, u8* data, i32 size, u32* out, i32 outCap, i32* scanned) {
+	__m128i needles[SCAN_QUERY_BYTES_MAX];
+	for (i32 byteIndex = 0; byteIndex < query->byteCount; byteIndex++) {
+		needles[byteIndex] = _mm_set1_epi8((char)query->bytes[byteIndex]);
+	}
+	__m128i continuationMax = _mm_set1_epi8((char)0xBF);
+	__m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+
+	i32 count = 0;
+	i32 offset = 0;
+	for (; offset + 16 <= size && outCap - count >= 16; offset += 16) {
+		__m128i chunk = _mm_loadu_si128((__m128i*)(data + offset));
+		__m128i matches = _mm_setzero_si128();
+		if (query->match == ScanMatch_Utf8Start) {
+			matches = _mm_cmpgt_epi8(chunk, continuationMax);
+		} else {
+			for (i32 byteIndex = 0; byteIndex < query->byteCount; byteIndex++) {
+				matches = _mm_or_si128(matches, _mm_cmpeq_epi8(chunk, needles[byteIndex]));
+			}
+		}
+		u32 mask = (u32)_mm_movemask_epi8(matches);
+		if (mask == 0xFFFF) {
+			for (i32 lane = 0; lane < 16; lane += 4) {
+				_mm_storeu_si128((__m128i*)(out + count + lane), _mm_add_epi32(_mm_set1_epi32(offset + lane), lanes));
+			}
+			count += 16;
+		} else {
+			for (; mask; mask &= mask - 1) {
+				out[count++] = (u32)(offset + scanCountTrailingZeros(mask));
+			}
+		}
+	}
+
+	i32 result = scanTail(query, data, offset, size, out, count, outCap, scanned);
+	return result;
+}
+
+SCAN_TARGET_AVX2 i32
+scanAVX2(ScanQuery* query, u8* data, i32 size, u32* out, i32 outCap, i32* scanned) {
+	__m256i needles[SCAN_QUERY_BYTES_MAX];
+	for (i32 byteIndex = 0; byteIndex < query->byteCount; byteIndex++) {
+		needles[byteIndex] = _mm256_set1_epi8((char)query->bytes[byteIndex]);
+	}
+	__m256i continuationMax = _mm256_set1_epi8((char)0xBF);
+	__m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	i32 count = 0;
+	i32 offset = 0;
+	for (; offset + 32 <= size && outCap - count >= 32; offset += 32) {
+		__m256i chunk = _mm256_loadu_si256((__m256i*)(data + offset));
+		__m256i matches = _mm256_setzero_si256();
+		if (query->match == ScanMatch_Utf8Start) {
+			matches = _mm256_cmpgt_epi8(chunk, continuationMax);
+		} else {
+			for (i32 byteIndex = 0; byteIndex < query->byteCount; byteIndex++) {
+				matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(chunk, needles[byteIndex]));
+			}
+		}
+		u32 mask = (u32)_mm256_movemask_epi8(matches);
+		if (mask == 0xFFFFFFFF) {
+			for (i32 lane = 0; lane < 32; lane += 8) {
+				_mm256_storeu_si256((__m256i*)(out + count + lane), _mm256_add_epi32(_mm256_set1_epi32(offset + lane), lanes));
+			}
+			count += 32;
+		} else {
+			for (; mask; mask &= mask - 1) {
+				out[count++] = (u32)(offset + scanCountTrailingZeros(mask));
+			}
+		}
+	}
+
+	i32 result = scanTail(query, data, offset, size, out, count, outCap, scanned);
+	return result;
+}
+
+#endif // SCAN_X86
+
+i32
+scanFind(ScanKernel kernel, ScanQuery* query, u8* data, i32 size, u32* out, i32 outCap, i32* scanned) {
+	i32 result = 0;
+	switch (kernel) {
+#if SCAN_X86
+	case ScanKernel_SSE2: {result = scanSSE2(query, data, size, out, outCap, scanned);} break;
+	case ScanKernel_AVX2: {result = scanAVX2(query, data, size, out, outCap, scanned);} break;
+#endif
+	default: {result = scanScalar(query, data, size, out, outCap, scanned);} break;
+	}
+	return result;
+}
+
+// NOTE(khvorov) Chunks are never cut short before they reach this many lines
+// unless their lines span more than 4 GB, so there is at most one of those
+// per 4 GB of file on top of the full ones
+i64
+lineIndexGetMaxChunks(i64 fileSize) {
+	i64 result = (fileSize + 1) / LINE_INDEX_CHUNK_LINES + fileSize / ((i64)UINT32_MAX + 1) + 2;
+	return result;
+}
+
+b32
+lineIndexInit(LineIndex* index, i64 fileSize) {
+	SDL_memset(index, 0, sizeof(LineIndex));
+	i64 maxChunks = lineIndexGetMaxChunks(fileSize);
+	size_t chunkBytes = (size_t)maxChunks * sizeof(LineIndexChunk) + ARENA_ALIGNMENT;
+	size_t offsetBytes = (size_t)maxChunks * LINE_INDEX_CHUNK_LINES * sizeof(u32) + ARENA_ALIGNMENT;
+	b32 result = arenaInit(&index->chunkArena, "line index chunks", chunkBytes)
+		&& arenaInit(&index->offsetArena, "line index offsets", offsetBytes);
+	index->chunks = (LineIndexChunk*)index->chunkArena.base;
+	return result;
+}
+
+void
+lineIndexRelease(LineIndex* index) {
+	arenaRelease(&index->chunkArena);
+	arenaRelease(&index->offsetArena);
+}
+
+LineIndexChunk*
+lineIndexBeginChunk(LineIndex* index, i64 firstLine, i64 baseOffset) {
+	i32 chunkCount = SDL_AtomicGet(&index->chunkCount);
+	LineIndexChunk* chunk = arenaAlloc(&index->chunkArena, sizeof(LineIndexChunk));
+	SDL_assert(chunk == index->chunks + chunkCount);
+	chunk->firstLine = firstLine;
+	chunk->baseOffset = baseOffset;
+	chunk->offsets = arenaAlloc(&index->offsetArena, LINE_INDEX_CHUNK_LINES * sizeof(u32));
+	SDL_AtomicSet(&chunk->lineCount, 0);
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&index->chunkCount, chunkCount + 1);
+	return chunk;
+}
+
+i64
+lineIndexGetLineCount(LineIndex* index) {
+	i64 result = 0;
+	i32 chunkCount = SDL_AtomicGet(&index->chunkCount);
+	if (chunkCount > 0) {
+		SDL_MemoryBarrierAcquire();
+		LineIndexChunk* last = index->chunks + chunkCount - 1;
+		result = last->firstLine + SDL_AtomicGet(&last->lineCount);
+	}
+	return result;
+}
+
+// NOTE(khvorov) Chunk that holds the line, found by binary search over the
+// chunks published so far
+LineIndexChunk*
+lineIndexFindChunkForLine(LineIndex* index, i64 line) {
+	i32 chunkCount = SDL_AtomicGet(&index->chunkCount);
+	SDL_MemoryBarrierAcquire();
+	i32 low = 0;
+	i32 high = chunkCount - 1;
+	while (low < high) {
+		i32 mid = low + (high - low + 1) / 2;
+		if (index->chunks[mid].firstLine <= line) {
+			low = mid;
+		} else {
+			high = mid - 1;
+		}
+	}
+	LineIndexChunk* result = chunkCount > 0 ? index->chunks + low : 0;
+	return result;
+}
+
+i64
+lineIndexGetLineStart(LineIndex* index, i64 line) {
+	i64 result = 0;
+	LineIndexChunk* chunk = lineIndexFindChunkForLine(index, line);
+	if (chunk) {
+		i32 lineCount = SDL_AtomicGet(&chunk->lineCount);
+		SDL_MemoryBarrierAcquire();
+		i64 lineInChunk = SDL_max(SDL_min(line - chunk->firstLine, (i64)lineCount - 1), 0);
+		result = chunk->baseOffset + chunk->offsets[lineInChunk];
+	}
+	return result;
+}
+
+// NOTE(khvorov) Line that contains the byte, or the last indexed line if the
+// index hasn't got that far yet
+i64
+lineIndexFindLineForOffset(LineIndex* index, i64 offset) {
+	i64 result = 0;
+	i32 chunkCount = SDL_AtomicGet(&index->chunkCount);
+	SDL_MemoryBarrierAcquire();
+	if (chunkCount > 0) {
+		i32 low = 0;
+		i32 high = chunkCount - 1;
+		while (low < high) {
+			i32 mid = low + (high - low + 1) / 2;
+			if (index->chunks[mid].baseOffset <= offset) {
+				low = mid;
+			} else {
+				high = mid - 1;
+			}
+		}
+
+		LineIndexChunk* chunk = index->chunks + low;
+		i32 lineCount = SDL_AtomicGet(&chunk->lineCount);
+		SDL_MemoryBarrierAcquire();
+		if (lineCount > 0) {
+			i64 offsetInChunk = offset - chunk->baseOffset;
+			i32 lineLow = 0;
+			i32 lineHigh = lineCount - 1;
+			while (lineLow < lineHigh) {
+				i32 mid = lineLow + (lineHigh - lineLow + 1) / 2;
+				if ((i64)chunk->offsets[mid] <= offsetInChunk) {
+					lineLow = mid;
+				} else {
+					lineHigh = mid - 1;
+				}
+			}
+			result = chunk->firstLine + lineLow;
+		} else {
+			result = SDL_max(chunk->firstLine - 1, 0);
+		}
+	}
+	return result;
+}
+
+#define FILE_VIEW_INDEX_BLOCK (1024 * 1024)
+
+// NOTE(khvorov) Publishes after every block so the first screen shows up
+// as soon as the first block is scanned rather than when the whole file is.
+// The ui is woken at most once per 16ms.
+int
+fileViewIndexMain(void* data) {
+	FileView* view = (FileView*)data;
+	LineIndex* index = &view->index;
+
+	LineIndexChunk* chunk = lineIndexBeginChunk(index, 0, 0);
+	i32 chunkLineCount = 1;
+	chunk->offsets[0] = 0;
+	i64 lineCount = 1;
+	u32 lastWakeTicks = 0;
+
+	ScanQuery newline = scanQueryBytes("\n");
+	u32 newlines[LINE_INDEX_CHUNK_LINES];
+
+	for (i64 blockStart = 0; blockStart < view->size && !SDL_AtomicGet(&view->quit); blockStart += FILE_VIEW_INDEX_BLOCK) {
+		i32 blockSize = (i32)SDL_min(FILE_VIEW_INDEX_BLOCK, view->size - blockStart);
+		for (i32 blockScanned = 0; blockScanned < blockSize;) {
+			i32 scanned = 0;
+			u8* scanStart = view->data + blockStart + blockScanned;
+			i32 newlineCount = scanFind(view->scanKernel, &newline, scanStart, blockSize - blockScanned, newlines, LINE_INDEX_CHUNK_LINES, &scanned);
+			for (i32 newlineIndex = 0; newlineIndex < newlineCount; newlineIndex++) {
+				i64 lineStart = blockStart + blockScanned + newlines[newlineIndex] + 1;
+				if (lineStart < view->size) {
+					if (chunkLineCount == LINE_INDEX_CHUNK_LINES || lineStart - chunk->baseOffset > (i64)UINT32_MAX) {
+						SDL_MemoryBarrierRelease();
+						SDL_AtomicSet(&chunk->lineCount, chunkLineCount);
+						chunk = lineIndexBeginChunk(index, lineCount, lineStart);
+						chunkLineCount = 0;
+					}
+					chunk->offsets[chunkLineCount++] = (u32)(lineStart - chunk->baseOffset);
+					lineCount += 1;
+				}
+			}
+			blockScanned += scanned;
+		}
+
+		SDL_MemoryBarrierRelease();
+		SDL_AtomicSet(&chunk->lineCount, chunkLineCount);
+
+		u32 ticks = SDL_GetTicks();
+		if (blockStart == 0 || ticks - lastWakeTicks >= 16) {
+			lastWakeTicks = ticks;
+			SDL_Event wake = {.type = view->wakeEventType};
+			SDL_PushEvent(&wake);
+		}
+	}
+
+	SDL_AtomicSet(&index->done, 1);
+	SDL_Event wake = {.type = view->wakeEventType};
+	SDL_PushEvent(&wake);
+
+#ifdef WIREDECK_DEBUG
+	f64 seconds = (f64)(SDL_GetPerformanceCounter() - view->indexStart) / (f64)SDL_GetPerformanceFrequency();
+	SDL_Log(
+		"file view %s: %lld lines in %.3fs (%.0f MB/s, %s), index %d KB",
+		view->name, (long long)lineCount, seconds, (f64)view->size / (1024.0 * 1024.0) / SDL_max(seconds, 1e-9),
+		scanGetKernelName(view->scanKernel),
+		(i32)((index->chunkArena.used + index->offsetArena.used) / 1024)
+	);
+#endif
+	return 0;
+}
+
+b32
+fileViewOpen(FileView* view, char* path) {
+	SDL_memset(view, 0, sizeof(FileView));
+	view->window.id = UIWindowID_Invalid;
+	view->name = path;
+	for (char* ch = path; *ch; ch++) {
+		if (*ch == '/' || *ch == '\\') {
+			view->name = ch + 1;
+		}
+	}
+
+	view->data = fileMapReadOnly(path, &view->size);
+	b32 result = view->data != 0;
+	if (result) {
+		result = lineIndexInit(&view->index, view->size);
+		if (result) {
+			view->wakeEventType = SDL_RegisterEvents(1);
+			view->scanKernel = scanGetBestKernel();
+			view->indexStart = SDL_GetPerformanceCounter();
+			view->indexThread = SDL_CreateThread(fileViewIndexMain, "wiredeck line index", view);
+			result = view->indexThread != 0;
+		}
+		if (!result) {
+			lineIndexRelease(&view->index);
+			fileUnmap(view->data, view->size);
+			view->data = 0;
+		}
+	} else {
+		SDL_Log("file view: could not map %s", path);
+	}
+	return result;
+}
+
+void
+fileViewClose(FileView* view) {
+	if (view->data) {
+		SDL_AtomicSet(&view->quit, 1);
+		SDL_WaitThread(view->indexThread, 0);
+		lineIndexRelease(&view->index);
+		fileUnmap(view->data, view->size);
+	}
+	SDL_memset(view, 0, sizeof(FileView));
+	view->window.id = UIWindowID_Invalid;
+}
+
+i32
+fileViewGetRow(void* data, i64 row, char* buf, i32 bufCap) {
+	FileView* view = (FileView*)data;
+	i32 result = SDL_snprintf(buf, bufCap, "%8lld  ", (long long)(row + 1));
+	result = SDL_min(result, bufCap - 1);
+
+	i64 lineStart = lineIndexGetLineStart(&view->index, row);
+	i64 lineEnd = SDL_min(lineStart + (bufCap - result), view->size);
+	for (i64 offset = lineStart; offset < lineEnd && result < bufCap; offset++) {
+		u8 byte = view->data[offset];
+		if (byte == '\n' || (byte == '\r' && (offset + 1 == view->size || view->data[offset + 1] == '\n'))) {
+			break;
+		}
+		buf[result++] = byte < ' ' ? ' ' : (char)byte;
+	}
+	return result;
+}
+
+void
+fileViewUpdateTitle(FileView* view, UI* ui) {
+	char title[UI_WINDOW_TITLE_CAP];
+	if (view->gotoLen > 0) {
+		SDL_snprintf(title, sizeof(title), "go to %.*s_", view->gotoLen, view->gotoText);
+	} else if (view->titlePercent < 100) {
+		SDL_snprintf(title, sizeof(title), "%d%% %s", view->titlePercent, view->name);
+	} else {
+		SDL_snprintf(title, sizeof(title), "%s", view->name);
+	}
+	uiSetWindowTitle(ui, view->window.id, title);
+}
+
+// NOTE(khvorov) Typing a number while the view is in front and pressing enter
+// jumps to that line, or to the line holding that byte offset if the number
+// ends in b. Both are a binary search over the index.
+void
+fileViewUpdate(FileView* view, UI* ui, Input* input) {
+	UIWindowID winID = uiGetWindowID(ui, view->window);
+	if (winID >= 0) {
+		b32 titleDirty = false;
+
+		i64 lineCount = lineIndexGetLineCount(&view->index);
+		uiListSetRowCount(ui, winID, lineCount);
+
+		i32 percent = SDL_AtomicGet(&view->index.done) ? 100 : (i32)(lineIndexGetLineStart(&view->index, lineCount - 1) * 100 / view->size);
+		if (percent != view->titlePercent) {
+			view->titlePercent = percent;
+			titleDirty = true;
+		}
+
+		if (ui->windows.front == winID) {
+			for (i32 textIndex = 0; textIndex < input->textLen; textIndex++) {
+				char ch = input->text[textIndex];
+				b32 digit = ch >= '0' && ch <= '9';
+				b32 byteSuffix = (ch == 'b' || ch == 'B') && view->gotoLen > 0;
+				if ((digit || byteSuffix) && view->gotoLen < FILE_VIEW_GOTO_CAP && (view->gotoLen == 0 || view->gotoText[view->gotoLen - 1] != 'b')) {
+					view->gotoText[view->gotoLen++] = byteSuffix ? 'b' : ch;
+					titleDirty = true;
+				}
+			}
+
+			if (wasPressed(input, InputKeyID_Backspace) && view->gotoLen > 0) {
+				view->gotoLen -= 1;
+				titleDirty = true;
+			}
+
+			if (wasPressed(input, InputKeyID_Escape) && view->gotoLen > 0) {
+				view->gotoLen = 0;
+				titleDirty = true;
+			}
+
+			if (wasPressed(input, InputKeyID_Enter) && view->gotoLen > 0) {
+				b32 byteOffset = view->gotoText[view->gotoLen - 1] == 'b';
+				i64 number = 0;
+				for (i32 charIndex = 0; charIndex < view->gotoLen - (byteOffset ? 1 : 0); charIndex++) {
+					number = SDL_min(number * 10 + (view->gotoText[charIndex] - '0'), (i64)1 << 62);
+				}
+				i64 line = byteOffset ? lineIndexFindLineForOffset(&view->index, number) : SDL_max(number - 1, 0);
+				line = SDL_min(line, SDL_max(lineCount - 1, 0));
+				uiListScrollTo(ui, winID, line * ui->listRowHeight);
+				view->gotoLen = 0;
+				titleDirty = true;
+			}
+		}
+
+		if (titleDirty) {
+			fileViewUpdateTitle(view, ui);
+		}
+	}
+}
+
+void
+fileViewCreateWindow(FileView* view, UI* ui) {
+	SDL_Rect rect = {.x = 150, .y = 150, .w = 600, .h = 500};
+	SDL_Color color = {.r = 150, .g = 120, .b = 0, .a = 255};
+	view->window = uiCreateWindow(ui, rect, color);
+	uiSetWindowList(ui, view->window.id, lineIndexGetLineCount(&view->index), fileViewGetRow, view);
+	view->titlePercent = -1;
+}
+
+void
+renderQueueInit(RenderQueue* queue, char** arenaNames, size_t arenaSize, char* canvasName) {
+	for (i32 frameIndex = 0; frameIndex < 3; frameIndex++) {
+		arenaInit(&queue->frames[frameIndex].arena, arenaNames[frameIndex], arenaSize);
+	}
+	arenaInit(&queue->canvasArena, canvasName, (size_t)RENDER_CANVAS_DIM_MAX * RENDER_CANVAS_DIM_MAX * sizeof(u32));
+	queue->building = 0;
+	SDL_AtomicSet(&queue->middle, 1);
+	queue->drawing = 2;
+}
+
+// NOTE(khvorov) Without a thread, or without a way to wake the ui thread up,
+// frames are drawn and presented by whoever publishes them
+void
+renderQueueStart(RenderQueue* queue, SDL_ThreadFunction threadMain, char* name, void* data, u32 presentEventType) {
+	queue->presentEventType = presentEventType;
+	queue->ready = SDL_CreateSemaphore(0);
+	queue->presented = SDL_CreateSemaphore(0);
+	if (queue->ready && queue->presented && presentEventType != (u32)-1) {
+		queue->thread = SDL_CreateThread(threadMain, name, data);
+	}
+	if (!queue->thread) {
+		SDL_Log("render: could not start the %s thread, drawing on the ui thread: %s", name, SDL_GetError());
+	}
+}
+
+void
+renderQueueDeinit(RenderQueue* queue) {
+	if (queue->thread) {
+		SDL_AtomicSet(&queue->quit, 1);
+		SDL_SemPost(queue->ready);
+		SDL_SemPost(queue->presented);
+		SDL_WaitThread(queue->thread, 0);
+	}
+	if (queue->ready) {
+		SDL_DestroySemaphore(queue->ready);
+	}
+	if (queue->presented) {
+		SDL_DestroySemaphore(queue->presented);
+	}
+	for (i32 frameIndex = 0; frameIndex < 3; frameIndex++) {
+		arenaRelease(&queue->frames[frameIndex].arena);
+	}
+	arenaRelease(&queue->canvasArena);
+}
+
+// NOTE(khvorov) Render thread side of the triple buffer
+b32
+renderQueueTakeLatest(RenderQueue* queue) {
+	i32 middle = SDL_AtomicGet(&queue->middle);
+	b32 result = (middle & RENDER_FRAME_FRESH) && SDL_AtomicCAS(&queue->middle, middle, queue->drawing);
+	if (result) {
+		queue->drawing = middle & RENDER_FRAME_INDEX_MASK;
+	}
+	return result;
+}
+
+// NOTE(khvorov) Ui thread side of the triple buffer
+RenderFrame*
+renderQueueBeginFrame(RenderQueue* queue) {
+	RenderFrame* frame = queue->frames + queue->building;
+	arenaReset(&frame->arena);
+	frame->inputTime = 0;
+	frame->windowJobCount = 0;
+	damageClear(&frame->damage);
+	return frame;
+}
+
+void
+renderQueuePublish(RenderQueue* queue) {
+	i32 previous = SDL_AtomicSet(&queue->middle, queue->building | RENDER_FRAME_FRESH);
+	queue->building = previous & RENDER_FRAME_INDEX_MASK;
+	if (queue->thread) {
+		SDL_SemPost(queue->ready);
+	}
+}
+
+// NOTE(khvorov) Render thread side. Every frame is damaged all over when the
+// window changes size, so there is nothing in the canvas worth keeping then.
+// A window bigger than the biggest canvas only shows the part that fits.
+RasterTarget*
+renderQueueSizeCanvas(RenderQueue* queue, i32 width, i32 height) {
+	width = SDL_clamp(width, 0, RENDER_CANVAS_DIM_MAX);
+	height = SDL_clamp(height, 0, RENDER_CANVAS_DIM_MAX);
+	RasterTarget* canvas = &queue->canvas;
+	if (!canvas->pixels || canvas->width != width || canvas->height != height) {
+		arenaReset(&queue->canvasArena);
+		canvas->pixels = arenaAlloc(&queue->canvasArena, (size_t)width * (size_t)height * sizeof(u32));
+		canvas->pitch = width;
+		canvas->width = width;
+		canvas->height = height;
+	}
+	return canvas;
+}
+
+// NOTE(khvorov) Render thread side of the present. The canvas and the frame are
+// the ui thread's until it's done presenting them.
+void
+renderQueueHandOff(RenderQueue* queue, RenderFrame* frame) {
+	queue->presenting = frame;
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&queue->presentPending, 1);
+	if (queue->thread) {
+		SDL_Event event = {.type = queue->presentEventType};
+		SDL_PushEvent(&event);
+		SDL_SemWait(queue->presented);
+	}
+}
+
+// NOTE(khvorov) Ui thread side of the present. The frame stays the ui
+// thread's until renderQueueFinishPresent.
+RenderFrame*
+renderQueueTakePresent(RenderQueue* queue) {
+	RenderFrame* result = 0;
+	if (SDL_AtomicGet(&queue->presentPending)) {
+		SDL_MemoryBarrierAcquire();
+		result = queue->presenting;
+	}
+	return result;
+}
+
+void
+renderQueueFinishPresent(RenderQueue* queue) {
+	SDL_AtomicSet(&queue->presentPending, 0);
+	if (queue->thread) {
+		SDL_SemPost(queue->presented);
+	}
+}
+
+// NOTE(khvorov) The window can have been resized since the frame was built,
+// the frame after that one is damaged all over
+void
+presentCanvas(SDL_Window* sdlWindow, RasterTarget* canvas, Damage* damage) {
+	SDL_Surface* surface = SDL_GetWindowSurface(sdlWindow);
+	if (surface && (!SDL_MUSTLOCK(surface) || SDL_LockSurface(surface) == 0)) {
+		SDL_Rect bounds = {.x = 0, .y = 0, .w = SDL_min(canvas->width, surface->w), .h = SDL_min(canvas->height, surface->h)};
+		for (i32 damageIndex = 0; damageIndex < damage->count; damageIndex++) {
+			SDL_Rect rect = rectIntersect(damage->rects[damageIndex], bounds);
+			if (rectArea(rect) > 0) {
+				u32* src = canvas->pixels + rect.y * canvas->pitch + rect.x;
+				u8* dest = (u8*)surface->pixels + rect.y * surface->pitch + rect.x * surface->format->BytesPerPixel;
+				SDL_ConvertPixels(
+					rect.w, rect.h, SDL_PIXELFORMAT_RGB888, src, canvas->pitch * (i32)sizeof(u32),
+					surface->format->format, dest, surface->pitch
+				);
+			}
+		}
+		if (SDL_MUSTLOCK(surface)) {
+			SDL_UnlockSurface(surface);
+		}
+		SDL_UpdateWindowSurfaceRects(sdlWindow, damage->rects, damage->count);
+	}
+}
+
+// NOTE(khvorov) Takes back the published frame if the render thread hasn't
+// gotten to it yet, so that it can be built again with whatever came since
+RenderFrame*
+renderQueueReclaim(RenderQueue* queue) {
+	RenderFrame* result = 0;
+	i32 middle = SDL_AtomicGet(&queue->middle);
+	if ((middle & RENDER_FRAME_FRESH) && SDL_AtomicCAS(&queue->middle, middle, queue->building)) {
+		queue->building = middle & RENDER_FRAME_INDEX_MASK;
+		queue->framesSkipped += 1;
+		result = queue->frames + queue->building;
+	}
+	return result;
+}
+
+// NOTE(khvorov) An os window showing one torn off window. The ui thread builds
+// frames for it like it does for the main window and its own render thread
+// rasterizes them into the queue's canvas, so a slow draw for one window holds
+// up neither the ui nor the other windows. The ui thread presents the canvas,
+// same as the main window's, since the window surface goes away under the
+// event pump. Nothing else is in the os window so the window's draw list goes
+// straight to the canvas without a cache. There is no renderer here, viewports
+// are always drawn with the rasterizer.
+typedef struct Viewport {
+	UIWindowHandle window;
+	SDL_Window* sdlWindow; // NOTE(khvorov) Null when the slot is free
+	u32 sdlWindowID;
+	SDL_Rect syncedRect; // NOTE(khvorov) Main window relative, where the ui and the os last agreed the window is
+	b32 translucent;
+	RenderQueue queue;
+
+	RasterPool raster; // NOTE(khvorov) Only the render thread touches it while it's running
+} Viewport;
+
+void
+viewportRenderFrame(Viewport* viewport, RenderFrame* frame) {
+	ProfileZone renderZone = profileBegin(ProfileZoneKind_Render);
+	RasterTarget* canvas = renderQueueSizeCanvas(&viewport->queue, frame->width, frame->height);
+	RasterPool* raster = &viewport->raster;
+	rasterBegin(raster);
+	for (i32 jobIndex = 0; jobIndex < frame->windowJobCount; jobIndex++) {
+		WindowJob* job = frame->windowJobs + jobIndex;
+		rasterAddList(raster, *canvas, &job->list, &job->dirty, 1);
+	}
+	rasterRun(raster);
+	profileEnd(renderZone);
+	renderQueueHandOff(&viewport->queue, frame);
+}
+
+// NOTE(khvorov) Ui thread side, same as appPresent for the main window
+void
+viewportPresent(Viewport* viewport) {
+	RenderFrame* frame = renderQueueTakePresent(&viewport->queue);
+	if (frame) {
+		ProfileZone presentZone = profileBegin(ProfileZoneKind_Present);
+		presentCanvas(viewport->sdlWindow, &viewport->queue.canvas, &frame->damage);
+		profileEnd(presentZone);
+		if (frame->inputTime) {
+			profileRecordInputToPresent(frame->inputTime);
+		}
+		renderQueueFinishPresent(&viewport->queue);
+	}
+}
+
+int
+viewportRenderThreadMain(void* data) {
+	Viewport* viewport = (Viewport*)data;
+	RenderQueue* queue = &viewport->queue;
+	while (!SDL_AtomicGet(&queue->quit)) {
+		SDL_SemWait(queue->ready);
+		if (renderQueueTakeLatest(queue)) {
+			viewportRenderFrame(viewport, queue->frames + queue->drawing);
+		}
+	}
+	return 0;
+}
+
+// NOTE(khvorov) Borderless since the window draws its own topbar and border.
+// One monitor is all an os window is on, so there is nothing to share with the
+// main window's raster workers and the render thread draws by itself.
+b32
+viewportOpen(Viewport* viewport, UIWindowHandle window, char* title, SDL_Rect screenRect, u8* glyphCoverage, u32 presentEventType) {
+	SDL_memset(viewport, 0, sizeof(Viewport));
+	viewport->window = window;
+	viewport->sdlWindow = SDL_CreateWindow(title, screenRect.x, screenRect.y, screenRect.w, screenRect.h, SDL_WINDOW_BORDERLESS);
+	b32 result = viewport->sdlWindow != 0;
+	if (result) {
+		viewport->sdlWindowID = SDL_GetWindowID(viewport->sdlWindow);
+		char* frameArenaNames[] = {"viewport frame 0", "viewport frame 1", "viewport frame 2"};
+		renderQueueInit(&viewport->queue, frameArenaNames, (size_t)64 * 1024 * 1024, "viewport canvas");
+		rasterPoolInit(&viewport->raster, 0);
+		viewport->raster.glyphCoverage = glyphCoverage;
+		renderQueueStart(&viewport->queue, viewportRenderThreadMain, "viewport render", viewport, presentEventType);
+	} else {
+		SDL_Log("viewport: could not create a window: %s", SDL_GetError());
+	}
+	return result;
+}
+
+void
+viewportClose(Viewport* viewport) {
+	renderQueueDeinit(&viewport->queue);
+	rasterPoolDeinit(&viewport->raster);
+	SDL_DestroyWindow(viewport->sdlWindow);
+	SDL_memset(viewport, 0, sizeof(Viewport));
+}
+
+typedef struct App {
+	SDL_Window* sdlWindow;
+	Arena persistentArena;
+	UI ui;
+	Font font;
+	FramePacer pacer;
+	PresentPolicy present;
+	FrameStats frameStats;
+	i32 renderedSizeCap;
+	SDL_Point* renderedSizes; // NOTE(khvorov) Window sizes as of their last job
+	FileView fileView;
+	b32 redrawAll;
+	u64 frameInputTime; // NOTE(khvorov) Oldest input the frame being built shows
+	b32 latencyFlash;
+	b32 latencyFlashLit;
+	RenderQueue queue;
+	u32 presentEventType;
+	Viewport viewports[UI_DETACHED_MAX];
+
+	// NOTE(khvorov) Only the render thread touches these while it's running
+	SDL_Renderer* sdlRenderer;
+	SDL_Surface* rendererSurface;
+	SDL_Texture* atlas;
+	SDL_Texture* screen; // NOTE(khvorov) What the composite is drawn into, only grows
+	i32 screenWidth;
+	i32 screenHeight;
+	Arena cacheArena; // NOTE(khvorov) Window caches and their pixels, never reset
+	i32 windowCacheCap;
+	WindowCache* windowCaches;
+	RasterPool raster;
+} App;
+
+void
+appInit(App* app, SDL_Window* sdlWindow) {
+	SDL_memset(app, 0, sizeof(App));
+	app->sdlWindow = sdlWindow;
+	arenaInit(&app->persistentArena, "persistent", (size_t)1024 * 1024 * 1024);
+	char* frameArenaNames[] = {"frame 0", "frame 1", "frame 2"};
+	renderQueueInit(&app->queue, frameArenaNames, (size_t)256 * 1024 * 1024, "canvas");
+	uiInit(&app->ui, &app->persistentArena);
+	fontInit(&app->font, &app->persistentArena, 14);
+	arenaInit(&app->cacheArena, "window caches", (size_t)4 * 1024 * 1024 * 1024);
+	rasterPoolInit(&app->raster, RASTER_WORKERS_MAX);
+	pacerSetRefreshRate(&app->pacer, sdlWindow);
+	app->presentEventType = SDL_RegisterEvents(1);
+	app->fileView.window.id = UIWindowID_Invalid;
+	app->redrawAll = true;
+}
+
+void
+appOpenFile(App* app, char* path) {
+	fileViewClose(&app->fileView);
+	if (fileViewOpen(&app->fileView, path)) {
+		fileViewCreateWindow(&app->fileView, &app->ui);
+	}
+}
+
+// NOTE(khvorov) A software renderer of our own on a surface of our own rather
+// than whatever SDL_CreateRenderer would pick for the window, so it is the
+// same renderer no matter which backends SDL was built with and nothing but us
+// ever touches it. It only draws into textures. Made the first time a frame
+// is drawn without tiles, if it can't be then frames are drawn with tiles.
+b32
+appCreateRenderer(App* app) {
+	app->rendererSurface = SDL_CreateRGBSurfaceWithFormat(0, 1, 1, 32, SDL_PIXELFORMAT_RGB888);
+	if (app->rendererSurface) {
+		app->sdlRenderer = SDL_CreateSoftwareRenderer(app->rendererSurface);
+	}
+	if (app->sdlRenderer) {
+		app->atlas = SDL_CreateTexture(app->sdlRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, GLYPH_ATLAS_DIM, GLYPH_ATLAS_DIM);
+	}
+	b32 result = app->atlas != 0;
+	if (result) {
+		SDL_SetTextureBlendMode(app->atlas, SDL_BLENDMODE_BLEND);
+		fontUploadAtlas(&app->font, app->atlas);
+	} else {
+		SDL_Log("render: could not create the renderer, drawing with tiles: %s", SDL_GetError());
+		app->raster.enabled = true;
+	}
+	return result;
+}
+
+// NOTE(khvorov) The renderer takes its textures with it
+void
+appDestroyRenderer(App* app) {
+	if (app->sdlRenderer) {
+		for (i32 cacheIndex = 0; cacheIndex < app->windowCacheCap; cacheIndex++) {
+			app->windowCaches[cacheIndex].texture = 0;
+		}
+		SDL_DestroyRenderer(app->sdlRenderer);
+	}
+	SDL_FreeSurface(app->rendererSurface);
+	app->sdlRenderer = 0;
+	app->rendererSurface = 0;
+	app->atlas = 0;
+	app->screen = 0;
+	app->screenWidth = 0;
+	app->screenHeight = 0;
+}
+
+// NOTE(khvorov) Render thread side of a window job. Caches grow by at least
+// half in the dimension that ran out so that dragging a window bigger leaves a
+// bounded amount of old pixels behind in the cache arena.
+void
+appRenderWindow(App* app, WindowJob* job, b32 onCpu) {
+	if (app->windowCacheCap <= job->window) {
+		i32 newCap = SDL_max(app->windowCacheCap * 2, job->window + 1);
+		app->windowCaches = arenaGrowArray(&app->cacheArena, app->windowCaches, app->windowCacheCap, newCap, sizeof(WindowCache));
+		SDL_memset(app->windowCaches + app->windowCacheCap, 0, (newCap - app->windowCacheCap) * sizeof(WindowCache));
+		app->windowCacheCap = newCap;
+	}
+
+	WindowCache* cache = app->windowCaches + job->window;
+	if (cache->texWidth < job->width || cache->texHeight < job->height) {
+		if (cache->texture) {
+			SDL_DestroyTexture(cache->texture);
+			cache->texture = 0;
+		}
+		cache->pixels = 0;
+		if (cache->texWidth < job->width) {
+			cache->texWidth = SDL_max(job->width, cache->texWidth + cache->texWidth / 2);
+		}
+		if (cache->texHeight < job->height) {
+			cache->texHeight = SDL_max(job->height, cache->texHeight + cache->texHeight / 2);
+		}
+	}
+
+	// NOTE(khvorov) The cpu side only bins the job here, the pool draws it
+	if (onCpu) {
+		if (!cache->pixels) {
+			cache->pixels = arenaAlloc(&app->cacheArena, (size_t)cache->texWidth * (size_t)cache->texHeight * sizeof(u32));
+		}
+		RasterTarget target = {.pixels = cache->pixels, .pitch = cache->texWidth, .width = job->width, .height = job->height};
+		rasterAddList(&app->raster, target, &job->list, &job->dirty, 1);
+	} else {
+		if (!cache->texture) {
+			cache->texture = SDL_CreateTexture(app->sdlRenderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_TARGET, cache->texWidth, cache->texHeight);
+			SDL_SetTextureBlendMode(cache->texture, SDL_BLENDMODE_NONE);
+		}
+		if (cache->texture) {
+			SDL_SetRenderTarget(app->sdlRenderer, cache->texture);
+			drawListSubmit(&job->list, app->sdlRenderer, job->dirty, app->atlas, 0);
+			SDL_SetRenderTarget(app->sdlRenderer, 0);
+		}
+	}
+}
+
+// NOTE(khvorov) Window caches first since the composite reads them. Only the
+// damaged tiles of the canvas are touched.
+void
+appRasterFrame(App* app, RenderFrame* frame, RasterTarget* canvas) {
+	RasterPool* raster = &app->raster;
+	rasterBegin(raster);
+	for (i32 jobIndex = 0; jobIndex < frame->windowJobCount; jobIndex++) {
+		appRenderWindow(app, frame->windowJobs + jobIndex, true);
+	}
+	raster->windowCaches = app->windowCaches;
+	raster->glyphCoverage = app->font.atlasCoverage;
+	rasterRun(raster);
+
+	rasterBegin(raster);
+	rasterAddList(raster, *canvas, &frame->composite, frame->damage.rects, frame->damage.count);
+	rasterRun(raster);
+}
+
+// NOTE(khvorov) The composite goes into the screen texture and the damaged
+// parts of it are read back out into the canvas
+void
+appRenderComposite(App* app, RenderFrame* frame, RasterTarget* canvas) {
+	if (app->screenWidth < canvas->width || app->screenHeight < canvas->height) {
+		if (app->screen) {
+			SDL_DestroyTexture(app->screen);
+		}
+		app->screenWidth = SDL_max(app->screenWidth, canvas->width);
+		app->screenHeight = SDL_max(app->screenHeight, canvas->height);
+		app->screen = SDL_CreateTexture(app->sdlRenderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_TARGET, app->screenWidth, app->screenHeight);
+		SDL_SetTextureBlendMode(app->screen, SDL_BLENDMODE_NONE);
+	}
+
+	if (app->screen) {
+		SDL_SetRenderTarget(app->sdlRenderer, app->screen);
+		for (i32 damageIndex = 0; damageIndex < frame->damage.count; damageIndex++) {
+			drawListSubmit(&frame->composite, app->sdlRenderer, frame->damage.rects[damageIndex], app->atlas, app->windowCaches);
+		}
+		SDL_Rect canvasRect = {.x = 0, .y = 0, .w = canvas->width, .h = canvas->height};
+		for (i32 damageIndex = 0; damageIndex < frame->damage.count; damageIndex++) {
+			SDL_Rect rect = rectIntersect(frame->damage.rects[damageIndex], canvasRect);
+			if (rectArea(rect) > 0) {
+				u32* pixels = canvas->pixels + rect.y * canvas->pitch + rect.x;
+				SDL_RenderReadPixels(app->sdlRenderer, &rect, SDL_PIXELFORMAT_RGB888, pixels, canvas->pitch * (i32)sizeof(u32));
+			}
+		}
+		SDL_SetRenderTarget(app->sdlRenderer, 0);
+	}
+}
+
+// NOTE(khvorov) Draws into the canvas, with tiles or through the renderer and
+// the glyph atlas texture, and hands it to the ui thread to present
+void
+appRenderFrame(App* app, RenderFrame* frame) {
+	ProfileZone renderZone = profileBegin(ProfileZoneKind_Render);
+	fontApplyUploads(&app->font, app->atlas);
+	if (!app->raster.enabled && !app->sdlRenderer) {
+		appCreateRenderer(app);
+	}
+
+	RasterTarget* canvas = renderQueueSizeCanvas(&app->queue, frame->width, frame->height);
+	if (app->raster.enabled) {
+		appRasterFrame(app, frame, canvas);
+	} else {
+		for (i32 jobIndex = 0; jobIndex < frame->windowJobCount; jobIndex++) {
+			appRenderWindow(app, frame->windowJobs + jobIndex, false);
+		}
+		appRenderComposite(app, frame, canvas);
+	}
+	profileEnd(renderZone);
+	frame->renderTicks = SDL_GetPerformanceCounter() - renderZone.start;
+	frame->heldTicks = presentPolicyWaitForSlot(&app->present);
+	renderQueueHandOff(&app->queue, frame);
+}
+
+// NOTE(khvorov) Called by the ui thread whenever it's up. Presents whatever
+// was drawn since, this is the part that can block.
+void
+appPresent(App* app) {
+	RenderFrame* frame = renderQueueTakePresent(&app->queue);
+	if (frame) {
+		ProfileZone presentZone = profileBegin(ProfileZoneKind_Present);
+		presentCanvas(app->sdlWindow, &app->queue.canvas, &frame->damage);
+		profileEnd(presentZone);
+		presentPolicyRecordPresent(&app->present, frame->renderTicks, presentZone.start);
+		pacerRecordPresent(&app->pacer, frame->frameStart, frame->heldTicks);
+		if (frame->inputTime) {
+			profileRecordInputToPresent(frame->inputTime);
+		}
+		renderQueueFinishPresent(&app->queue);
+	}
+	for (i32 viewportIndex = 0; viewportIndex < UI_DETACHED_MAX; viewportIndex++) {
+		if (app->viewports[viewportIndex].sdlWindow) {
+			viewportPresent(app->viewports + viewportIndex);
+		}
+	}
+}
+
+// NOTE(khvorov) The renderer is made and destroyed here, the event pump never
+// sees it
+int
+appRenderThreadMain(void* data) {
+	App* app = (App*)data;
+	RenderQueue* queue = &app->queue;
+	while (!SDL_AtomicGet(&queue->quit)) {
+		SDL_SemWait(queue->ready);
+		if (renderQueueTakeLatest(queue)) {
+			appRenderFrame(app, queue->frames + queue->drawing);
+		}
+	}
+	appDestroyRenderer(app);
+	return 0;
+}
+
+// NOTE(khvorov) Without the thread frames are drawn and presented on the
+// calling thread
+void
+appStartRenderThread(App* app) {
+	renderQueueStart(&app->queue, appRenderThreadMain, "render", app, app->presentEventType);
+}
+
+void
+appDeinit(App* app) {
+	for (i32 viewportIndex = 0; viewportIndex < UI_DETACHED_MAX; viewportIndex++) {
+		if (app->viewports[viewportIndex].sdlWindow) {
+			viewportClose(app->viewports + viewportIndex);
+		}
+	}
+	renderQueueDeinit(&app->queue);
+	fileViewClose(&app->fileView);
+	appDestroyRenderer(app);
+	arenaRelease(&app->cacheArena);
+	rasterPoolDeinit(&app->raster);
+	fontDeinit(&app->font);
+	if (app->ui.pick.enabled) {
+		arenaRelease(&app->ui.pick.arena);
+	}
+	arenaRelease(&app->persistentArena);
+}
+
+u64
+inputTimeOldest(u64 a, u64 b) {
+	u64 result = a == 0 ? b : (b == 0 ? a : SDL_min(a, b));
+	return result;
+}
+
+// NOTE(khvorov) Everything a frame that was taken back would have drawn is
+// damaged again and its input goes into the next frame
+void
+appTakeBackFrame(App* app, RenderFrame* frame) {
+	app->frameInputTime = inputTimeOldest(app->frameInputTime, frame->inputTime);
+	for (i32 jobIndex = 0; jobIndex < frame->windowJobCount; jobIndex++) {
+		WindowJob* job = frame->windowJobs + jobIndex;
+		if (app->ui.windows.flags[job->window] & UIWindowFlag_Alive) {
+			SDL_Rect winRect = uiGetWindowRect(&app->ui, job->window);
+			SDL_Rect dirty = job->dirty;
+			dirty.x += winRect.x;
+			dirty.y += winRect.y;
+			uiDamageWindow(&app->ui, job->window, dirty);
+		}
+	}
+}
+
+// NOTE(khvorov) A frame that was published but never drawn is taken back
+// before the render thread gets to it, so that the next frame covers both.
+// Same for every os window.
+void
+appReclaimUndrawnFrames(App* app) {
+	RenderFrame* frame = renderQueueReclaim(&app->queue);
+	if (frame) {
+		appTakeBackFrame(app, frame);
+		for (i32 damageIndex = 0; damageIndex < frame->damage.count; damageIndex++) {
+			uiDamageRect(&app->ui, frame->damage.rects[damageIndex]);
+		}
+	}
+
+	for (i32 viewportIndex = 0; viewportIndex < UI_DETACHED_MAX; viewportIndex++) {
+		Viewport* viewport = app->viewports + viewportIndex;
+		RenderFrame* viewportFrame = viewport->sdlWindow ? renderQueueReclaim(&viewport->queue) : 0;
+		if (viewportFrame) {
+			appTakeBackFrame(app, viewportFrame);
+		}
+	}
+}
+
+void
+appPublishFrame(App* app) {
+	RenderQueue* queue = &app->queue;
+	renderQueuePublish(queue);
+	if (!queue->thread && renderQueueTakeLatest(queue)) {
+		appRenderFrame(app, queue->frames + queue->drawing);
+		appPresent(app);
+	}
+}
+
+// NOTE(khvorov) Records what it takes to bring the window's cached pixels up
+// to date. Only the dirty part is redrawn unless the window changed size.
+void
+appBuildWindowJob(App* app, RenderFrame* frame, UIWindowID winID) {
+	if (app->renderedSizeCap < app->ui.windows.cap) {
+		i32 newCap = app->ui.windows.cap;
+		app->renderedSizes = arenaGrowArray(&app->persistentArena, app->renderedSizes, app->renderedSizeCap, newCap, sizeof(SDL_Point));
+		SDL_memset(app->renderedSizes + app->renderedSizeCap, 0, (newCap - app->renderedSizeCap) * sizeof(SDL_Point));
+		app->renderedSizeCap = newCap;
+	}
+
+	SDL_Point* renderedSize = app->renderedSizes + winID;
+	SDL_Rect winRect = uiGetWindowRect(&app->ui, winID);
+	SDL_Rect* dirty = app->ui.windows.dirtyRects + winID;
+	if (renderedSize->x != winRect.w || renderedSize->y != winRect.h) {
+		*renderedSize = (SDL_Point) {.x = winRect.w, .y = winRect.h};
+		*dirty = (SDL_Rect) {.w = winRect.w, .h = winRect.h};
+	}
+
+	if (rectArea(*dirty) > 0) {
+		WindowJob* job = frame->windowJobs + frame->windowJobCount++;
+		job->window = winID;
+		job->width = winRect.w;
+		job->height = winRect.h;
+		job->dirty = *dirty;
+		drawListClear(&job->list, &frame->arena);
+		job->list.origin = (SDL_Point) {.x = winRect.x, .y = winRect.y};
+		drawWindow(&job->list, &app->ui, &app->font, winID);
+		drawListMerge(&job->list);
+		app->frameStats.windowsRendered += 1;
+	}
+	*dirty = (SDL_Rect) {0};
+}
+
+// NOTE(khvorov) Os windows get moved by the window manager and stay put when
+// the main window moves, so before the ui sees the input torn off windows are
+// put where their os windows are. Not while they're dragged, the os lags
+// behind the positions the ui asks for.
+void
+appPullViewports(App* app, Input* input) {
+	UI* ui = &app->ui;
+	i32 mainX, mainY;
+	SDL_GetWindowPosition(app->sdlWindow, &mainX, &mainY);
+	ui->cursorDetachedWindow = UIWindowID_Invalid;
+	for (i32 viewportIndex = 0; viewportIndex < UI_DETACHED_MAX; viewportIndex++) {
+		Viewport* viewport = app->viewports + viewportIndex;
+		UIWindowID winID = viewport->sdlWindow ? uiGetWindowID(ui, viewport->window) : UIWindowID_Invalid;
+		if (winID >= 0 && (ui->windows.flags[winID] & UIWindowFlag_Detached)) {
+			if (!(ui->windows.flags[winID] & UIWindowFlag_Dragged)) {
+				SDL_Rect osRect;
+				SDL_GetWindowPosition(viewport->sdlWindow, &osRect.x, &osRect.y);
+				SDL_GetWindowSize(viewport->sdlWindow, &osRect.w, &osRect.h);
+				osRect.x -= mainX;
+				osRect.y -= mainY;
+				if (!rectsEqual(osRect, viewport->syncedRect)) {
+					uiSetWindowRect(ui, winID, osRect);
+					viewport->syncedRect = osRect;
+				}
+			}
+			if (viewport->sdlWindowID == input->cursorWindowID) {
+				ui->cursorDetachedWindow = winID;
+			}
+		}
+	}
+}
+
+// NOTE(khvorov) Opens and closes os windows to match the ui's torn off windows
+// and moves them to where the ui put them. A window that can't get an os
+// window goes back into the main one. Dragged windows are see-through so that
+// the dock targets under them show.
+void
+appPushViewports(App* app) {
+	UI* ui = &app->ui;
+	UIWindows* windows = &ui->windows;
+	for (i32 viewportIndex = 0; viewportIndex < UI_DETACHED_MAX; viewportIndex++) {
+		Viewport* viewport = app->viewports + viewportIndex;
+		if (viewport->sdlWindow) {
+			UIWindowID winID = uiGetWindowID(ui, viewport->window);
+			if (winID < 0 || !(windows->flags[winID] & UIWindowFlag_Detached)) {
+				viewportClose(viewport);
+			}
+		}
+	}
+
+	i32 mainX, mainY;
+	SDL_GetWindowPosition(app->sdlWindow, &mainX, &mainY);
+	for (i32 detachedIndex = 0; detachedIndex < ui->detachedCount;) {
+		UIWindowID winID = ui->detachedWindows[detachedIndex];
+		UIWindowHandle handle = {.id = winID, .generation = windows->generations[winID]};
+		Viewport* viewport = 0;
+		Viewport* freeViewport = 0;
+		for (i32 viewportIndex = 0; viewportIndex < UI_DETACHED_MAX; viewportIndex++) {
+			Viewport* candidate = app->viewports + viewportIndex;
+			if (!candidate->sdlWindow) {
+				freeViewport = freeViewport ? freeViewport : candidate;
+			} else if (candidate->window.id == handle.id && candidate->window.generation == handle.generation) {
+				viewport = candidate;
+			}
+		}
+
+		SDL_Rect winRect = uiGetWindowRect(ui, winID);
+		if (!viewport && freeViewport) {
+			char title[UI_WINDOW_TITLE_CAP + 1];
+			UIWindowTitle* winTitle = windows->titles + winID;
+			SDL_memcpy(title, winTitle->chars, winTitle->len);
+			title[winTitle->len] = '\0';
+			SDL_Rect screenRect = {.x = winRect.x + mainX, .y = winRect.y + mainY, .w = winRect.w, .h = winRect.h};
+			if (viewportOpen(freeViewport, handle, title, screenRect, app->font.atlasCoverage, app->presentEventType)) {
+				viewport = freeViewport;
+				viewport->syncedRect = winRect;
+			}
+		}
+
+		if (viewport) {
+			if (!rectsEqual(winRect, viewport->syncedRect)) {
+				SDL_SetWindowPosition(viewport->sdlWindow, winRect.x + mainX, winRect.y + mainY);
+				if (winRect.w != viewport->syncedRect.w || winRect.h != viewport->syncedRect.h) {
+					SDL_SetWindowSize(viewport->sdlWindow, winRect.w, winRect.h);
+				}
+				viewport->syncedRect = winRect;
+			}
+			b32 dragged = (windows->flags[winID] & UIWindowFlag_Dragged) != 0;
+			if (dragged != viewport->translucent) {
+				SDL_SetWindowOpacity(viewport->sdlWindow, dragged ? 0.5f : 1.0f);
+				viewport->translucent = dragged;
+			}
+			detachedIndex += 1;
+		} else {
+			uiAttachWindow(ui, winID);
+		}
+	}
+}
+
+// NOTE(khvorov) Same as the main window minus the composite. The frame's
+// damage is the os window's, not the main screen's.
+void
+appBuildViewportFrames(App* app) {
+	for (i32 viewportIndex = 0; viewportIndex < UI_DETACHED_MAX; viewportIndex++) {
+		Viewport* viewport = app->viewports + viewportIndex;
+		if (viewport->sdlWindow) {
+			RenderQueue* queue = &viewport->queue;
+			RenderFrame* frame = renderQueueBeginFrame(queue);
+			frame->inputTime = app->frameInputTime;
+			frame->windowJobs = arenaAlloc(&frame->arena, sizeof(WindowJob));
+			appBuildWindowJob(app, frame, viewport->window.id);
+			if (frame->windowJobCount > 0) {
+				frame->width = frame->windowJobs[0].width;
+				frame->height = frame->windowJobs[0].height;
+				damageAdd(&frame->damage, frame->windowJobs[0].dirty);
+				renderQueuePublish(queue);
+				if (!queue->thread && renderQueueTakeLatest(queue)) {
+					viewportRenderFrame(viewport, queue->frames + queue->drawing);
+					viewportPresent(viewport);
+				}
+			}
+		}
+	}
+}
+
+SDL_Rect
+appGetLatencyFlashRect(App* app) {
+	i32 size = 4 * app->ui.windowTopBarHeight;
+	SDL_Rect result = {.x = 0, .y = app->ui.height - size, .w = size, .h = size};
+	return result;
+}
+
+// NOTE(khvorov) Everything a frame needs once input has been collected.
+// The bench drives this directly with scripted input. Frames are built here
+// and drawn either on the render thread or, without one, at the end of appFrame.
+// Either way the ui thread presents them.
+void
+appFrame(App* app, Input* input) {
+	u64 frameStart = SDL_GetPerformanceCounter();
+	appPresent(app);
+	app->frameInputTime = input->eventTime;
+	appReclaimUndrawnFrames(app);
+	RenderFrame* frame = renderQueueBeginFrame(&app->queue);
+
+	// NOTE(khvorov) The canvas is as big as the window
+	{
+		i32 width, height;
+		SDL_GetWindowSize(app->sdlWindow, &width, &height);
+		if (width != app->ui.width || height != app->ui.height) {
+			uiSetSize(&app->ui, width, height);
+		}
+	}
+
+	if (fontProcessResults(&app->font)) {
+		for (i32 rectIndex = 0; rectIndex < app->font.placeholderDamage.count; rectIndex++) {
+			uiDamageWindowsUnder(&app->ui, app->font.placeholderDamage.rects[rectIndex]);
+		}
+		damageClear(&app->font.placeholderDamage);
+	}
+
+	if (app->redrawAll) {
+		uiDamageEverything(&app->ui);
+		for (i32 detachedIndex = 0; detachedIndex < app->ui.detachedCount; detachedIndex++) {
+			UIWindowID winID = app->ui.detachedWindows[detachedIndex];
+			uiDamageWindow(&app->ui, winID, uiGetWindowRect(&app->ui, winID));
+		}
+		pacerSetRefreshRate(&app->pacer, app->sdlWindow);
+		app->redrawAll = false;
+	}
+
+	// NOTE(khvorov) Flips on every click so that a camera watching both the
+	// mouse and the screen can time the change against the click. Looked at
+	// before the ui since the ui eats presses.
+	if (app->latencyFlash && wasPressed(input, InputKeyID_MouseLeft)) {
+		app->latencyFlashLit = !app->latencyFlashLit;
+		uiDamageRect(&app->ui, appGetLatencyFlashRect(app));
+	}
+
+	ProfileZone updateZone = profileBegin(ProfileZoneKind_Update);
+	appPullViewports(app, input);
+	uiUpdate(&app->ui, input);
+	fileViewUpdate(&app->fileView, &app->ui, input);
+	appPushViewports(app);
+	profileEnd(updateZone);
+
+	if (wasPressed(input, InputKeyID_F2)) {
+		profileDumpChromeTrace("wiredeck_trace.json");
+	}
+
+	// NOTE(khvorov) The canvas keeps its contents between frames, so only the
+	// damaged parts need to be redrawn and sent to the screen. The draw zone
+	// is building the frame, the render thread does the drawing.
+	if (app->ui.damage.count > 0) {
+
+		ProfileZone drawZone = profileBegin(ProfileZoneKind_Draw);
+		SDL_Color bgColor = {.r = 20, .g = 20, .b = 20, .a = 255};
+		SDL_Color dockRectColor = {.r = 0, .g = 0, .b = 255, .a = 255};
+
+		// NOTE(khvorov) Windows are opaque, so going front to back each one
+		// gets the part of the damage that nothing in front of it has taken.
+		// Whatever is left at the end is background. Windows that get nothing
+		// are neither rendered nor copied, torn off ones are not on the screen.
+		Region* uncovered = arenaAlloc(&frame->arena, sizeof(Region));
+		uncovered->count = app->ui.damage.count;
+		SDL_memcpy(uncovered->rects, app->ui.damage.rects, app->ui.damage.count * sizeof(SDL_Rect));
+		Region** visibleRegions = arenaAlloc(&frame->arena, app->ui.windows.slotCount * sizeof(Region*));
+		i32 pixelsDrawnUnculled = damageGetPixelCount(&app->ui.damage);
+		app->frameStats.windowsCulled = 0;
+		for (UIWindowID winID = app->ui.windows.front; winID >= 0; winID = app->ui.windows.behind[winID]) {
+			visibleRegions[winID] = 0;
+			SDL_Rect winRect = uiGetWindowRect(&app->ui, winID);
+			b32 detached = (app->ui.windows.flags[winID] & UIWindowFlag_Detached) != 0;
+			if (!detached && rectArea(winRect) > 0 && damageIntersects(&app->ui.damage, winRect)) {
+				for (i32 damageIndex = 0; damageIndex < app->ui.damage.count; damageIndex++) {
+					pixelsDrawnUnculled += rectArea(rectIntersect(app->ui.damage.rects[damageIndex], winRect));
+				}
+				Region* visible = arenaAlloc(&frame->arena, sizeof(Region));
+				regionIntersectRect(uncovered, winRect, visible);
+				if (visible->count > 0) {
+					visibleRegions[winID] = visible;
+					regionSubtract(uncovered, winRect);
+				} else {
+					app->frameStats.windowsCulled += 1;
+				}
+			}
+		}
+
+		app->frameStats.windowsRendered = 0;
+		frame->windowJobs = arenaAlloc(&frame->arena, app->ui.windows.slotCount * sizeof(WindowJob));
+		for (UIWindowID winID = app->ui.windows.back; winID >= 0; winID = app->ui.windows.inFront[winID]) {
+			if (visibleRegions[winID]) {
+				appBuildWindowJob(app, frame, winID);
+			}
+		}
+
+		// NOTE(khvorov) The screen is a composite of the cached windows. Back to
+		// front still, since a region that ran out of room to subtract from
+		// overlaps the windows in front of it.
+		DrawList* composite = &frame->composite;
+		drawListClear(composite, &frame->arena);
+
+		// NOTE(khvorov) The pick buffer follows the same order so that it
+		// matches what ends up on screen
+		b32 pickEnabled = app->ui.pick.enabled;
+		for (i32 rectIndex = 0; rectIndex < uncovered->count; rectIndex++) {
+			drawRect(composite, uncovered->rects[rectIndex], bgColor);
+			if (pickEnabled) {
+				uiPickPaintBackground(&app->ui, uncovered->rects[rectIndex]);
+			}
+		}
+		i32 pixelsDrawn = regionGetArea(uncovered);
+
+		for (UIWindowID winID = app->ui.windows.back; winID >= 0; winID = app->ui.windows.inFront[winID]) {
+			Region* visible = visibleRegions[winID];
+			if (visible) {
+				SDL_Rect winRect = uiGetWindowRect(&app->ui, winID);
+				for (i32 rectIndex = 0; rectIndex < visible->count; rectIndex++) {
+					SDL_Rect rect = visible->rects[rectIndex];
+					SDL_Rect texRect = {.x = rect.x - winRect.x, .y = rect.y - winRect.y, .w = rect.w, .h = rect.h};
+					drawWindowImage(composite, winID, rect, texRect);
+					if (pickEnabled) {
+						uiPickPaintWindow(&app->ui, winID, rect);
+					}
+				}
+				pixelsDrawn += regionGetArea(visible);
+			}
+		}
+
+		for (i32 targetIndex = 0; targetIndex < app->ui.dockTargetCount; targetIndex++) {
+			SDL_Rect rect = app->ui.dockTargets[targetIndex].rect;
+			if (damageIntersects(&app->ui.damage, rect)) {
+				drawRect(composite, rect, dockRectColor);
+				for (i32 damageIndex = 0; damageIndex < app->ui.damage.count; damageIndex++) {
+					i32 dockPixels = rectArea(rectIntersect(app->ui.damage.rects[damageIndex], rect));
+					pixelsDrawn += dockPixels;
+					pixelsDrawnUnculled += dockPixels;
+				}
+			}
+		}
+
+		if (pickEnabled) {
+			for (i32 damageIndex = 0; damageIndex < app->ui.damage.count; damageIndex++) {
+				uiPickPaintDockTargets(&app->ui, app->ui.damage.rects[damageIndex]);
+			}
+		}
+
+		SDL_Rect flashRect = appGetLatencyFlashRect(app);
+		if (app->latencyFlash && damageIntersects(&app->ui.damage, flashRect)) {
+			SDL_Color flashColor = {.r = 0, .g = 0, .b = 0, .a = 255};
+			if (app->latencyFlashLit) {
+				flashColor = (SDL_Color) {.r = 255, .g = 255, .b = 255, .a = 255};
+			}
+			drawRect(composite, flashRect, flashColor);
+		}
+
+		drawListMerge(composite);
+		frame->damage = app->ui.damage;
+		frame->inputTime = app->frameInputTime;
+		frame->frameStart = frameStart;
+		frame->width = app->ui.width;
+		frame->height = app->ui.height;
+		profileEnd(drawZone);
+
+		appPublishFrame(app);
+
+		app->frameStats.pixelsTouched = damageGetPixelCount(&app->ui.damage);
+		app->frameStats.drawCmdCount = composite->cmdCount;
+		app->frameStats.drawBatchCount = composite->batchCount;
+		app->frameStats.pixelsDrawn = pixelsDrawn;
+		app->frameStats.pixelsDrawnUnculled = pixelsDrawnUnculled;
+		f32 pixelsTouched = (f32)SDL_max(app->frameStats.pixelsTouched, 1);
+		profileSetCounter(ProfileCounterKind_PixelsTouched, (f32)app->frameStats.pixelsTouched);
+		profileSetCounter(ProfileCounterKind_Overdraw, (f32)pixelsDrawn / pixelsTouched);
+		profileSetCounter(ProfileCounterKind_OverdrawUnculled, (f32)pixelsDrawnUnculled / pixelsTouched);
+		profileSetCounter(ProfileCounterKind_DrawCmds, (f32)app->frameStats.drawCmdCount);
+		profileSetCounter(ProfileCounterKind_DrawBatches, (f32)app->frameStats.drawBatchCount);
+		profileSetCounter(ProfileCounterKind_WindowsRendered, (f32)app->frameStats.windowsRendered);
+		profileSetCounter(ProfileCounterKind_WindowsCulled, (f32)app->frameStats.windowsCulled);
+		profileSetCounter(ProfileCounterKind_FramesSkipped, (f32)app->queue.framesSkipped);
+		damageClear(&app->ui.damage);
+	} else {
+		SDL_memset(&app->frameStats, 0, sizeof(app->frameStats));
+	}
+
+	appBuildViewportFrames(app);
+	app->frameInputTime = 0;
+
+	// NOTE(khvorov) The graph shows this frame from the next one on
+	profileEndFrame();
+	UIWindowID profilerWinID = uiGetWindowID(&app->ui, app->ui.profilerWindow);
+	if (profilerWinID >= 0) {
+		uiDamageWindow(&app->ui, profilerWinID, uiGetWindowContentRect(&app->ui, profilerWinID));
 	}
 }
 
+#ifndef WIREDECK_NO_MAIN
+
 int
 SDL_main(int argc, char* argv[]) {
 	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) == 0) {
@@ -361,72 +5824,166 @@ SDL_main(int argc, char* argv[]) {
 		SDL_Window* sdlWindow = SDL_CreateWindow("wiredeck", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 1000, 1000, SDL_WINDOW_RESIZABLE);
 		if (sdlWindow) {
 
-			SDL_Renderer* sdlRenderer = SDL_CreateRenderer(sdlWindow, -1, SDL_RENDERER_PRESENTVSYNC);
-			if (sdlRenderer) {
+			// NOTE(khvorov) SDL by default does not send mouse clicks when clicking on an unfocused window
+			{
+				i32 clickthrough = 1;
+				SDL_SetHint(SDL_HINT_MOUSE_FOCUS_CLICKTHROUGH, (const char*)&clickthrough);
+			}
+
+			char* recordPath = 0;
+			char* replayPath = 0;
+			char* openPath = 0;
+			b32 pickBuffer = false;
+			b32 noTiles = false;
+			b32 latencyFlash = false;
+			for (i32 argIndex = 1; argIndex < argc; argIndex++) {
+				b32 hasValue = argIndex + 1 < argc;
+				if (hasValue && SDL_strcmp(argv[argIndex], "--record") == 0) {
+					recordPath = argv[++argIndex];
+				} else if (hasValue && SDL_strcmp(argv[argIndex], "--replay") == 0) {
+					replayPath = argv[++argIndex];
+				} else if (hasValue && SDL_strcmp(argv[argIndex], "--open") == 0) {
+					openPath = argv[++argIndex];
+				} else if (SDL_strcmp(argv[argIndex], "--pick-buffer") == 0) {
+					pickBuffer = true;
+				} else if (SDL_strcmp(argv[argIndex], "--no-tiles") == 0) {
+					noTiles = true;
+				} else if (SDL_strcmp(argv[argIndex], "--latency-flash") == 0) {
+					latencyFlash = true;
+				}
+			}
+
+			Input input = {0};
+			input.cursorX = -1;
+			input.cursorY = -1;
+
+			App app;
+			appInit(&app, sdlWindow);
+			if (pickBuffer) {
+				uiPickEnable(&app.ui);
+			}
+			app.raster.enabled = !noTiles;
+			app.latencyFlash = latencyFlash;
+			if (openPath) {
+				appOpenFile(&app, openPath);
+			}
+
+			b32 running = true;
+			if (replayPath) {
+
+				// NOTE(khvorov) Frames run back to back so that the timings
+				// reflect the work and not the pacing of the original session
+				SDL_RWops* replay = inputRecordingOpenRead(replayPath);
+				if (replay) {
+					i32 frameCount = 0;
+					i32 frameCap = 0;
+					f64* frameMs = 0;
+					u64 replayStart = SDL_GetPerformanceCounter();
+
+					i32 width = 0;
+					i32 height = 0;
+					while (running && inputRecordingReadFrame(replay, &input, &width, &height)) {
+						i32 windowWidth, windowHeight;
+						SDL_GetWindowSize(sdlWindow, &windowWidth, &windowHeight);
+						if (windowWidth != width || windowHeight != height) {
+							SDL_SetWindowSize(sdlWindow, width, height);
+						}
+
+						Input ignoredInput = {0};
+						pollEvents(sdlWindow, &running, &app.redrawAll, &ignoredInput);
+
+						// NOTE(khvorov) As if all of the frame's input arrived just as it started
+						u64 frameStart = SDL_GetPerformanceCounter();
+						input.eventTime = frameStart;
+						appFrame(&app, &input);
+
+						if (frameCount == frameCap) {
+							frameCap = frameCap == 0 ? 1024 : frameCap * 2;
+							frameMs = reallocArray(frameMs, frameCap, sizeof(f64));
+						}
+						frameMs[frameCount++] = (f64)(SDL_GetPerformanceCounter() - frameStart) * 1000.0 / (f64)SDL_GetPerformanceFrequency();
+					}
+
+					f64 replaySeconds = (f64)(SDL_GetPerformanceCounter() - replayStart) / (f64)SDL_GetPerformanceFrequency();
+					if (frameCount > 0) {
+						SDL_qsort(frameMs, frameCount, sizeof(f64), compareF64);
+						SDL_Log(
+							"replay: %d frames in %.3fs, p50 %.3fms, p99 %.3fms, max %.3fms",
+							frameCount, replaySeconds, frameMs[frameCount / 2],
+							frameMs[SDL_min(frameCount * 99 / 100, frameCount - 1)], frameMs[frameCount - 1]
+						);
+					}
 
-				// NOTE(khvorov) SDL by default does not send mouse clicks when clicking on an unfocused window
-				{
-					i32 clickthrough = 1;
-					SDL_SetHint(SDL_HINT_MOUSE_FOCUS_CLICKTHROUGH, (const char*)&clickthrough);
+					SDL_free(frameMs);
+					SDL_RWclose(replay);
 				}
 
-				Input input = {0};
-				input.cursorX = -1;
-				input.cursorY = -1;
+			} else {
 
-				UI ui = {0};
-				uiInit(&ui);
+				SDL_RWops* recording = recordPath ? inputRecordingOpenWrite(recordPath) : 0;
+				appStartRenderThread(&app);
 
-				b32 running = true;
 				while (running) {
 
 					clearHalfTransitionCounts(&input);
 
 					SDL_Event event;
 					SDL_WaitEvent(&event);
-					processEvent(sdlWindow, &event, &running, &input);
-					pollEvents(sdlWindow, &running, &input);
-
-					{
-						SDL_Rect viewport;
-						SDL_RenderGetViewport(sdlRenderer, &viewport);
-						ui.width = viewport.w;
-						ui.height = viewport.h;
+
+					// NOTE(khvorov) A render thread is done with a frame. Nothing
+					// changed for the ui, so no frame for it.
+					if (event.type == app.presentEventType) {
+						appPresent(&app);
+						continue;
 					}
 
-					SDL_SetRenderDrawColor(sdlRenderer, 20, 20, 20, 255);
-					SDL_RenderClear(sdlRenderer);
+					ProfileZone eventsZone = profileBegin(ProfileZoneKind_Events);
+					b32 batchEnded = processEvent(sdlWindow, &event, &running, &app.redrawAll, &input);
+					if (!batchEnded) {
+						batchEnded = pollEvents(sdlWindow, &running, &app.redrawAll, &input);
+					}
+					profileEnd(eventsZone);
 
-					{
-						UIWindowID windowOrder[UIWindowID_Count];
-						for (i32 winOrderIndex = 0; winOrderIndex < UIWindowID_Count; winOrderIndex++) {
-							windowOrder[winOrderIndex] = ui.windowOrder[winOrderIndex];
+					// NOTE(khvorov) Keep collecting input until it's time to start the frame
+					ProfileZone paceWaitZone = profileBegin(ProfileZoneKind_PaceWait);
+					while (running && !batchEnded && SDL_AtomicGet(&app.present.mode) == PresentMode_Capped) {
+						i32 waitMs = pacerGetWaitMs(&app.pacer);
+						if (waitMs <= 0 || !SDL_WaitEventTimeout(&event, waitMs)) {
+							break;
 						}
-
-						for (i32 winOrderIndex = 0; winOrderIndex < UIWindowID_Count; winOrderIndex++) {
-							UIWindowID winID = windowOrder[winOrderIndex];
-							uiWindowUpdate(&ui, winID, &input);
+						batchEnded = processEvent(sdlWindow, &event, &running, &app.redrawAll, &input);
+						if (!batchEnded) {
+							batchEnded = pollEvents(sdlWindow, &running, &app.redrawAll, &input);
 						}
+						appPresent(&app);
 					}
+					profileEnd(paceWaitZone);
 
-					for (i32 winOrderIndex = UIWindowID_Count - 1; winOrderIndex >= 0; winOrderIndex--) {
-						UIWindowID winID = ui.windowOrder[winOrderIndex];
-						drawWindow(sdlRenderer, &ui, winID);
+					// NOTE(khvorov) Recorded before the frame since the ui consumes presses
+					if (recording) {
+						i32 windowWidth, windowHeight;
+						SDL_GetWindowSize(sdlWindow, &windowWidth, &windowHeight);
+						inputRecordingWriteFrame(recording, &input, windowWidth, windowHeight);
 					}
 
-					SDL_Color dockRectColor = {.r = 0, .g = 0, .b = 255, .a = 255};
-					SDL_Rect rootDockRects[DockPos_Count];
-					uiGetRootDockRects(&ui, rootDockRects);
-					for (DockPos pos = 0; pos < DockPos_Count; pos++) {
-						SDL_Rect rect = rootDockRects[pos];
-						drawRect(sdlRenderer, rect, dockRectColor);
-					}
+					appFrame(&app, &input);
 
-					SDL_RenderPresent(sdlRenderer);
+					b32 dragging = input.keys[InputKeyID_MouseLeft].endedDown;
+					b32 animated = input.eventTime == 0 && app.frameStats.pixelsTouched > 0;
+					presentPolicyChoose(&app.present, &app.pacer, dragging, animated);
+				}
+
+				if (recording) {
+					SDL_RWclose(recording);
 				}
 			}
+
+			profileLogInputToPresent();
+			appDeinit(&app);
 		}
 	}
 
 	return 0;
 }
+
+#endif // WIREDECK_NO_MAIN
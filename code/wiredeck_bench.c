@@ -0,0 +1,804 @@
+#define WIREDECK_NO_MAIN
+#include "wiredeck.c"
+
+typedef struct Rng {
+	u32 state;
+} Rng;
+
+u32
+rngNext(Rng* rng) {
+	u32 x = rng->state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	rng->state = x;
+	return x;
+}
+
+i32
+rngRange(Rng* rng, i32 min, i32 max) {
+	i32 result = min + (i32)(rngNext(rng) % (u32)(max - min));
+	return result;
+}
+
+f64
+getSecondsSince(u64 start) {
+	u64 now = SDL_GetPerformanceCounter();
+	f64 result = (f64)(now - start) / (f64)SDL_GetPerformanceFrequency();
+	return result;
+}
+
+// NOTE(khvorov) What uiWindowUpdate used to do for every window, kept here as the baseline
+UIWindowID
+getTopmostWindowAtLinear(UI* ui, i32 pointX, i32 pointY) {
+	UIWindowID result = UIWindowID_Invalid;
+	for (UIWindowID winID = ui->windows.front; winID >= 0; winID = ui->windows.behind[winID]) {
+		if (pointInRect(pointX, pointY, uiGetWindowRect(ui, winID))) {
+			result = winID;
+			break;
+		}
+	}
+	return result;
+}
+
+typedef enum HitTestLayout {
+	HitTestLayout_Scattered, // NOTE(khvorov) Random floating windows piled on top of each other
+	HitTestLayout_Tiled, // NOTE(khvorov) Screen split evenly between panels, like a full deck
+	HitTestLayout_Count,
+} HitTestLayout;
+
+void
+benchHitTest(HitTestLayout layout) {
+	i32 width = 1920;
+	i32 height = 1080;
+	i32 queryCount = 100000;
+	SDL_Point* queries = reallocArray(0, queryCount, sizeof(SDL_Point));
+
+	char* layoutNames[HitTestLayout_Count] = {"scattered", "tiled"};
+	char* layoutName = layoutNames[layout];
+	SDL_Log("hittest %s: windows, linear ns/query, grid ns/query, pick buffer ns/query", layoutName);
+
+	i32 crossoverCount = 0;
+	b32 gridWasFaster = false;
+	for (i32 windowCount = 1; windowCount <= 4096; windowCount *= 2) {
+		Arena arena;
+		arenaInit(&arena, "hittest", (size_t)1024 * 1024 * 1024);
+		UI ui;
+		uiInit(&ui, &arena);
+		uiSetSize(&ui, width, height);
+		while (ui.windows.liveCount > 0) {
+			UIWindowID winID = ui.windows.front;
+			UIWindowHandle handle = {.id = winID, .generation = ui.windows.generations[winID]};
+			uiDestroyWindow(&ui, handle);
+		}
+
+		Rng rng = {.state = 0x12345678};
+		SDL_Color color = {.r = 100, .g = 100, .b = 100, .a = 255};
+		switch (layout) {
+		case HitTestLayout_Scattered: {
+			for (i32 winIndex = 0; winIndex < windowCount; winIndex++) {
+				i32 winWidth = rngRange(&rng, 50, 400);
+				i32 winHeight = rngRange(&rng, 50, 300);
+				SDL_Rect rect = {.x = rngRange(&rng, -50, width), .y = rngRange(&rng, -50, height), .w = winWidth, .h = winHeight};
+				uiCreateWindow(&ui, rect, color);
+			}
+		} break;
+
+		case HitTestLayout_Tiled: {
+			i32 columns = 1;
+			while (columns * columns < windowCount) {
+				columns += 1;
+			}
+			i32 rows = (windowCount + columns - 1) / columns;
+			i32 tileWidth = width / columns;
+			i32 tileHeight = height / rows;
+			for (i32 winIndex = 0; winIndex < windowCount; winIndex++) {
+				SDL_Rect rect = {.x = (winIndex % columns) * tileWidth, .y = (winIndex / columns) * tileHeight, .w = tileWidth, .h = tileHeight};
+				uiCreateWindow(&ui, rect, color);
+			}
+		} break;
+
+		case HitTestLayout_Count: break;
+		}
+
+		for (i32 queryIndex = 0; queryIndex < queryCount; queryIndex++) {
+			queries[queryIndex].x = rngRange(&rng, 0, width);
+			queries[queryIndex].y = rngRange(&rng, 0, height);
+		}
+
+		// NOTE(khvorov) Sum the results so that neither loop gets optimized out
+		// and so that we can check they agree
+		i64 linearSum = 0;
+		u64 linearStart = SDL_GetPerformanceCounter();
+		for (i32 queryIndex = 0; queryIndex < queryCount; queryIndex++) {
+			linearSum += getTopmostWindowAtLinear(&ui, queries[queryIndex].x, queries[queryIndex].y);
+		}
+		f64 linearSeconds = getSecondsSince(linearStart);
+
+		i64 gridSum = 0;
+		u64 gridStart = SDL_GetPerformanceCounter();
+		for (i32 queryIndex = 0; queryIndex < queryCount; queryIndex++) {
+			gridSum += uiGetTopmostWindowAt(&ui, queries[queryIndex].x, queries[queryIndex].y);
+		}
+		f64 gridSeconds = getSecondsSince(gridStart);
+
+		// NOTE(khvorov) Paint the whole screen the way the draw pass would
+		SDL_Rect screenRect = {.x = 0, .y = 0, .w = width, .h = height};
+		uiPickEnable(&ui);
+		uiPickPaintBackground(&ui, screenRect);
+		for (UIWindowID winID = ui.windows.back; winID >= 0; winID = ui.windows.inFront[winID]) {
+			uiPickPaintWindow(&ui, winID, screenRect);
+		}
+		uiPickPaintDockTargets(&ui, screenRect);
+		damageClear(&ui.damage);
+
+		i64 pickSum = 0;
+		u64 pickStart = SDL_GetPerformanceCounter();
+		for (i32 queryIndex = 0; queryIndex < queryCount; queryIndex++) {
+			pickSum += uiPickAt(&ui, queries[queryIndex].x, queries[queryIndex].y).window;
+		}
+		f64 pickSeconds = getSecondsSince(pickStart);
+
+		if (linearSum != gridSum) {
+			SDL_Log("hittest %s: grid and linear results differ for %d windows", layoutName, windowCount);
+		}
+		if (linearSum != pickSum) {
+			SDL_Log("hittest %s: pick buffer and linear results differ for %d windows", layoutName, windowCount);
+		}
+
+		f64 linearNs = linearSeconds * 1e9 / (f64)queryCount;
+		f64 gridNs = gridSeconds * 1e9 / (f64)queryCount;
+		f64 pickNs = pickSeconds * 1e9 / (f64)queryCount;
+		SDL_Log("hittest %s: %d, %.1f, %.1f, %.1f", layoutName, windowCount, linearNs, gridNs, pickNs);
+
+		// NOTE(khvorov) Every crossover, the grid can win in the middle and lose at the ends
+		b32 gridIsFaster = gridNs < linearNs;
+		if (windowCount > 1 && gridIsFaster != gridWasFaster) {
+			SDL_Log("hittest %s: crossover at %d windows, %s is faster from here", layoutName, windowCount, gridIsFaster ? "grid" : "linear");
+			crossoverCount += 1;
+		}
+		gridWasFaster = gridIsFaster;
+		arenaRelease(&ui.pick.arena);
+		arenaRelease(&arena);
+	}
+
+	if (crossoverCount == 0) {
+		SDL_Log("hittest %s: %s is faster at every window count", layoutName, gridWasFaster ? "grid" : "linear");
+	}
+
+	SDL_free(queries);
+}
+
+// NOTE(khvorov) Log-like text with a line every ~60 bytes, a delimiter every
+// ~8 and a multibyte character every so often
+u8*
+scanBenchMakeText(i32 size) {
+	u8* text = reallocArray(0, size, 1);
+	Rng rng = {.state = 0xdeadbeef};
+	char* multibyte[] = {"\xc3\xbc", "\xce\xb1", "\xe2\x86\x92", "\xf0\x9f\x99\x82"};
+	for (i32 offset = 0; offset < size;) {
+		u32 roll = rngNext(&rng) % 64;
+		if (roll == 0) {
+			text[offset++] = '\n';
+		} else if (roll < 8) {
+			text[offset++] = roll & 1 ? ',' : '\t';
+		} else if (roll == 8) {
+			char* ch = multibyte[rngNext(&rng) % 4];
+			for (; *ch && offset < size; ch++) {
+				text[offset++] = (u8)*ch;
+			}
+		} else {
+			text[offset++] = (u8)('a' + roll % 26);
+		}
+	}
+	return text;
+}
+
+void
+benchScan(void) {
+	i32 size = 64 * 1024 * 1024;
+	i32 repeatCount = 8;
+	u8* text = scanBenchMakeText(size);
+	i32 outCap = 64 * 1024;
+	u32* out = reallocArray(0, outCap, sizeof(u32));
+
+	char* queryNames[] = {"newline", "delimiter", "utf8"};
+	ScanQuery queries[] = {scanQueryBytes("\n"), scanQueryBytes(",\t\n"), scanQueryUtf8Starts()};
+	ScanKernel bestKernel = scanGetBestKernel();
+
+	SDL_Log("scan: kernel, GB/s, speedup over scalar");
+	for (i32 queryIndex = 0; queryIndex < (i32)SDL_arraysize(queries); queryIndex++) {
+		ScanQuery* query = queries + queryIndex;
+		i64 scalarCount = 0;
+		u64 scalarChecksum = 0;
+		f64 scalarGBs = 0;
+		for (ScanKernel kernel = 0; kernel <= bestKernel; kernel++) {
+
+			// NOTE(khvorov) Sum the offsets so that the work isn't optimized out
+			// and so that the kernels can be checked against each other
+			i64 count = 0;
+			u64 checksum = 0;
+			u64 start = SDL_GetPerformanceCounter();
+			for (i32 repeat = 0; repeat < repeatCount; repeat++) {
+				for (i32 offset = 0; offset < size;) {
+					i32 scanned = 0;
+					i32 found = scanFind(kernel, query, text + offset, size - offset, out, outCap, &scanned);
+					for (i32 foundIndex = 0; foundIndex < found; foundIndex++) {
+						checksum += out[foundIndex];
+					}
+					count += found;
+					offset += scanned;
+				}
+			}
+			f64 gbs = (f64)size * (f64)repeatCount / getSecondsSince(start) / 1e9;
+
+			if (kernel == ScanKernel_Scalar) {
+				scalarCount = count;
+				scalarChecksum = checksum;
+				scalarGBs = gbs;
+			} else if (count != scalarCount || checksum != scalarChecksum) {
+				SDL_Log("scan %s: %s and scalar results differ", queryNames[queryIndex], scanGetKernelName(kernel));
+			}
+			SDL_Log("scan %s: %s, %.2f, %.1fx", queryNames[queryIndex], scanGetKernelName(kernel), gbs, gbs / scalarGBs);
+		}
+	}
+
+	SDL_free(out);
+	SDL_free(text);
+}
+
+// NOTE(khvorov) Redraws a 4k screen of text heavy windows from scratch with
+// one core up to all of them drawing tiles. The frame is built once and
+// only the drawing is timed.
+void
+benchTiles(void) {
+	i32 width = 3840;
+	i32 height = 2160;
+	SDL_Window* sdlWindow = SDL_CreateWindow("wiredeck_bench_4k", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height, 0);
+	if (sdlWindow) {
+		App app;
+		appInit(&app, sdlWindow);
+
+		i32 columns = 6;
+		i32 rows = 4;
+		for (i32 winIndex = 0; winIndex < columns * rows; winIndex++) {
+			SDL_Rect rect = {
+				.x = (winIndex % columns) * width / columns, .y = (winIndex / columns) * height / rows,
+				.w = width / columns, .h = height / rows,
+			};
+			SDL_Color color = {.r = 0, .g = 150, .b = 150, .a = 255};
+			UIWindowHandle handle = uiCreateWindow(&app.ui, rect, color);
+			uiSetWindowList(&app.ui, handle.id, 1000 * 1000, uiListDemoGetRow, "row");
+		}
+
+		// NOTE(khvorov) Wait for the glyphs so that text and not placeholders gets drawn
+		Input input = {0};
+		appFrame(&app, &input);
+		for (i32 waitIndex = 0; waitIndex < 1000 && app.font.inFlight > 0; waitIndex++) {
+			SDL_Delay(1);
+			appFrame(&app, &input);
+		}
+		for (UIWindowID winID = app.ui.windows.front; winID >= 0; winID = app.ui.windows.behind[winID]) {
+			uiDamageWindow(&app.ui, winID, uiGetWindowRect(&app.ui, winID));
+		}
+		uiDamageEverything(&app.ui);
+		appFrame(&app, &input);
+		RenderFrame* frame = app.queue.frames + app.queue.drawing;
+
+		SDL_Log("tiles 4k: %d window jobs, %d commands in the composite", frame->windowJobCount, frame->composite.cmdCount);
+		SDL_Log("tiles 4k: cores, ms/frame, speedup over one core");
+		i32 repeatCount = 20;
+		f64 oneCoreMs = 0;
+		for (i32 coreCount = 1; coreCount <= app.raster.workerCount + 1; coreCount++) {
+			app.raster.activeWorkerCount = coreCount - 1;
+			u64 start = SDL_GetPerformanceCounter();
+			for (i32 repeat = 0; repeat < repeatCount; repeat++) {
+				appRenderFrame(&app, frame);
+			}
+			f64 ms = getSecondsSince(start) * 1000.0 / (f64)repeatCount;
+			if (coreCount == 1) {
+				oneCoreMs = ms;
+			}
+			SDL_Log("tiles 4k: %d, %.2f, %.2fx", coreCount, ms, oneCoreMs / ms);
+		}
+
+		// NOTE(khvorov) What the same frame costs through the software renderer
+		app.raster.enabled = false;
+		appRenderFrame(&app, frame);
+		u64 rendererStart = SDL_GetPerformanceCounter();
+		for (i32 repeat = 0; repeat < repeatCount; repeat++) {
+			appRenderFrame(&app, frame);
+		}
+		f64 rendererMs = getSecondsSince(rendererStart) * 1000.0 / (f64)repeatCount;
+		SDL_Log("tiles 4k: renderer, %.2f, %.2fx", rendererMs, oneCoreMs / rendererMs);
+
+		appDeinit(&app);
+	} else {
+		SDL_Log("tiles 4k: could not create a window: %s", SDL_GetError());
+	}
+	if (sdlWindow) {
+		SDL_DestroyWindow(sdlWindow);
+	}
+}
+
+// NOTE(khvorov) Panels are docked into each other as a binary heap, each one
+// taking as much of what its parent has left as its subtree needs so that
+// all of them end up the same size. Resizing the first panel lays out every
+// one of them, a splitter lays out the subtrees on both of its sides.
+void
+benchDockLayout(void) {
+	i32 width = 3840;
+	i32 height = 2160;
+	i32 repeatCount = 100;
+	f64 frameBudgetUs = 1000.0 * 1000.0 / 60.0;
+	SDL_Log("dock layout: panels, resize us, splitter us at depth 1, half way down, at the bottom, worst %% of a 60hz frame");
+
+	for (i32 panelCount = 64; panelCount <= 4096; panelCount *= 4) {
+		Arena arena;
+		arenaInit(&arena, "docklayout", (size_t)1024 * 1024 * 1024);
+		UI ui;
+		uiInit(&ui, &arena);
+		uiSetSize(&ui, width, height);
+		while (ui.windows.liveCount > 0) {
+			UIWindowID winID = ui.windows.front;
+			UIWindowHandle handle = {.id = winID, .generation = ui.windows.generations[winID]};
+			uiDestroyWindow(&ui, handle);
+		}
+
+		i32* subtreeSizes = reallocArray(0, panelCount, sizeof(i32));
+		for (i32 panelIndex = panelCount - 1; panelIndex >= 0; panelIndex--) {
+			subtreeSizes[panelIndex] = 1;
+			for (i32 childIndex = 2 * panelIndex + 1; childIndex <= 2 * panelIndex + 2 && childIndex < panelCount; childIndex++) {
+				subtreeSizes[panelIndex] += subtreeSizes[childIndex];
+			}
+		}
+
+		SDL_Color color = {.r = 100, .g = 100, .b = 100, .a = 255};
+		SDL_Rect screenRect = {.x = 0, .y = 0, .w = width, .h = height};
+		UIWindowID* panels = reallocArray(0, panelCount, sizeof(UIWindowID));
+		i32 maxDepth = 0;
+		for (i32 panelIndex = 0; panelIndex < panelCount; panelIndex++) {
+			panels[panelIndex] = uiCreateWindow(&ui, screenRect, color).id;
+			if (panelIndex > 0) {
+				i32 parentIndex = (panelIndex - 1) / 2;
+				i32 depth = 0;
+				for (i32 ancestorIndex = panelIndex; ancestorIndex > 0; ancestorIndex = (ancestorIndex - 1) / 2) {
+					depth += 1;
+				}
+				maxDepth = SDL_max(maxDepth, depth);
+
+				// NOTE(khvorov) The first child takes its share out of everything under
+				// the parent, the second out of itself and the parent
+				b32 firstChild = panelIndex & 1;
+				b32 splitX = firstChild == (depth & 1);
+				DockPos pos = splitX ? DockPos_Left : DockPos_Top;
+				i32 shareOf = firstChild ? subtreeSizes[parentIndex] : subtreeSizes[panelIndex] + 1;
+				uiDock(&ui, panels[panelIndex], panels[parentIndex], pos);
+				ui.windows.dockFractions[panels[panelIndex]] = (f32)subtreeSizes[panelIndex] / (f32)shareOf;
+			}
+		}
+		uiLayout(&ui);
+		damageClear(&ui.damage);
+
+		u64 resizeStart = SDL_GetPerformanceCounter();
+		for (i32 repeat = 0; repeat < repeatCount; repeat++) {
+			SDL_Rect rect = screenRect;
+			rect.w -= (repeat & 1) * width / 4;
+			uiSetWindowRect(&ui, panels[0], rect);
+			uiLayout(&ui);
+			damageClear(&ui.damage);
+		}
+		f64 resizeUs = getSecondsSince(resizeStart) * 1000.0 * 1000.0 / (f64)repeatCount;
+
+		// NOTE(khvorov) The first panel at each depth, or the one above it if
+		// its splitter has no room to move
+		i32 depths[3] = {1, maxDepth / 2, maxDepth};
+		f64 splitterUs[3] = {0};
+		f64 worstUs = resizeUs;
+		i32 minSize = ui.windowTopBarHeight + 2 * ui.windowBorderThickness;
+		for (i32 depthIndex = 0; depthIndex < 3; depthIndex++) {
+			i32 panelIndex = (1 << depths[depthIndex]) - 1;
+			while (panelIndex > 1) {
+				SDL_Rect space = ui.windows.dockSpaces[panels[panelIndex]];
+				i32 extent = ui.windows.dockPositions[panels[panelIndex]] == DockPos_Left ? space.w : space.h;
+				if (extent > 2 * minSize + 8) {
+					break;
+				}
+				panelIndex = (panelIndex - 1) / 2;
+			}
+			UIWindowID panelID = panels[panelIndex];
+			SDL_Rect splitter = ui.windows.splitterRects[panelID];
+			b32 splitX = ui.windows.dockPositions[panelID] == DockPos_Left;
+			u64 splitterStart = SDL_GetPerformanceCounter();
+			for (i32 repeat = 0; repeat < repeatCount; repeat++) {
+				i32 offset = (repeat & 1) * 4;
+				i32 cursorX = splitter.x + splitter.w / 2 + (splitX ? offset : 0);
+				i32 cursorY = splitter.y + splitter.h / 2 + (splitX ? 0 : offset);
+				uiDragSplitter(&ui, panelID, cursorX, cursorY);
+				uiLayout(&ui);
+				damageClear(&ui.damage);
+			}
+			splitterUs[depthIndex] = getSecondsSince(splitterStart) * 1000.0 * 1000.0 / (f64)repeatCount;
+			worstUs = SDL_max(worstUs, splitterUs[depthIndex]);
+		}
+
+		SDL_Log(
+			"dock layout: %d, %.2f, %.2f, %.2f, %.2f, %.2f%%",
+			panelCount, resizeUs, splitterUs[0], splitterUs[1], splitterUs[2], worstUs / frameBudgetUs * 100.0
+		);
+
+		SDL_free(panels);
+		SDL_free(subtreeSizes);
+		arenaRelease(&arena);
+	}
+}
+
+// NOTE(khvorov) Counts every allocation that goes through SDL, which is
+// all of ours and all of SDL's
+typedef struct AllocCounter {
+	SDL_malloc_func malloc;
+	SDL_calloc_func calloc;
+	SDL_realloc_func realloc;
+	SDL_free_func free;
+	SDL_atomic_t count;
+} AllocCounter;
+
+AllocCounter globalAllocCounter;
+
+void*
+countingMalloc(size_t size) {
+	SDL_AtomicAdd(&globalAllocCounter.count, 1);
+	void* result = globalAllocCounter.malloc(size);
+	return result;
+}
+
+void*
+countingCalloc(size_t count, size_t size) {
+	SDL_AtomicAdd(&globalAllocCounter.count, 1);
+	void* result = globalAllocCounter.calloc(count, size);
+	return result;
+}
+
+void*
+countingRealloc(void* ptr, size_t size) {
+	SDL_AtomicAdd(&globalAllocCounter.count, 1);
+	void* result = globalAllocCounter.realloc(ptr, size);
+	return result;
+}
+
+void
+countingFree(void* ptr) {
+	globalAllocCounter.free(ptr);
+}
+
+void
+allocCounterInstall(void) {
+	AllocCounter* counter = &globalAllocCounter;
+	SDL_GetOriginalMemoryFunctions(&counter->malloc, &counter->calloc, &counter->realloc, &counter->free);
+	SDL_SetMemoryFunctions(countingMalloc, countingCalloc, countingRealloc, countingFree);
+}
+
+typedef enum Scenario {
+	Scenario_DragStorm, // NOTE(khvorov) Grab a window and swing it around the screen
+	Scenario_DockCycles, // NOTE(khvorov) Drag a window onto the dock target, then tear it back off
+	Scenario_ManyWindows, // NOTE(khvorov) Click and drag around a pile of floating windows
+	Scenario_ListScroll, // NOTE(khvorov) Wheel through a 10M row list, then drag its thumb end to end
+	Scenario_Count,
+} Scenario;
+
+char*
+scenarioGetName(Scenario scenario) {
+	char* result = "";
+	switch (scenario) {
+	case Scenario_DragStorm: {result = "drag_storm";} break;
+	case Scenario_DockCycles: {result = "dock_cycles";} break;
+	case Scenario_ManyWindows: {result = "many_windows";} break;
+	case Scenario_ListScroll: {result = "list_scroll";} break;
+	case Scenario_Count: break;
+	}
+	return result;
+}
+
+void
+scriptMouse(Input* input, i32 cursorX, i32 cursorY, b32 down) {
+	input->cursorX = cursorX;
+	input->cursorY = cursorY;
+	if (input->keys[InputKeyID_MouseLeft].endedDown != down) {
+		recordKey(input, InputKeyID_MouseLeft, down);
+	}
+}
+
+SDL_Point
+scriptGetTopbarCenter(UI* ui, UIWindowID winID) {
+	SDL_Rect topbar = uiGetWindowTopbarRect(ui, winID);
+	SDL_Point result = {.x = topbar.x + topbar.w / 2, .y = topbar.y + topbar.h / 2};
+	return result;
+}
+
+SDL_Point
+scriptLerp(SDL_Point from, SDL_Point to, i32 step, i32 stepCount) {
+	SDL_Point result = {
+		.x = from.x + (to.x - from.x) * step / stepCount,
+		.y = from.y + (to.y - from.y) * step / stepCount,
+	};
+	return result;
+}
+
+// NOTE(khvorov) Sets up the input for one frame. Everything is derived
+// from the frame index and the current ui state so a run is repeatable.
+void
+scriptFrame(App* app, Input* input, Scenario scenario, i32 frameIndex, Rng* rng, SDL_Point* dragFrom) {
+	UI* ui = &app->ui;
+	SDL_Point screenCenter = {.x = ui->width / 2, .y = ui->height / 2};
+
+	switch (scenario) {
+	case Scenario_DragStorm: {
+		i32 cycleLength = 120;
+		i32 cycleFrame = frameIndex % cycleLength;
+		if (cycleFrame == 0) {
+			*dragFrom = scriptGetTopbarCenter(ui, ui->windows.front);
+			scriptMouse(input, dragFrom->x, dragFrom->y, true);
+		} else {
+			f32 angle = (f32)cycleFrame / (f32)cycleLength * 2.0f * 3.14159265f;
+			i32 radius = SDL_min(ui->width, ui->height) / 3;
+			i32 cursorX = screenCenter.x + (i32)(SDL_cosf(angle) * (f32)radius);
+			i32 cursorY = screenCenter.y + (i32)(SDL_sinf(angle) * (f32)radius);
+			scriptMouse(input, cursorX, cursorY, cycleFrame != cycleLength - 1);
+		}
+	} break;
+
+	case Scenario_DockCycles: {
+		i32 halfCycleLength = 20;
+		i32 cycleFrame = frameIndex % (halfCycleLength * 2);
+		i32 halfCycleFrame = cycleFrame % halfCycleLength;
+		b32 docking = cycleFrame < halfCycleLength;
+		if (halfCycleFrame == 0) {
+			*dragFrom = scriptGetTopbarCenter(ui, ui->windows.front);
+			scriptMouse(input, dragFrom->x, dragFrom->y, true);
+		} else {
+			SDL_Point undockTo = {.x = ui->width / 5, .y = ui->height / 5};
+			SDL_Point to = docking ? screenCenter : undockTo;
+			SDL_Point cursor = scriptLerp(*dragFrom, to, halfCycleFrame, halfCycleLength - 1);
+			scriptMouse(input, cursor.x, cursor.y, halfCycleFrame != halfCycleLength - 1);
+		}
+	} break;
+
+	case Scenario_ManyWindows: {
+		i32 cycleLength = 10;
+		i32 cycleFrame = frameIndex % cycleLength;
+		if (cycleFrame == 0) {
+			dragFrom->x = rngRange(rng, 0, ui->width);
+			dragFrom->y = rngRange(rng, 0, ui->height);
+			scriptMouse(input, dragFrom->x, dragFrom->y, true);
+		} else {
+			// NOTE(khvorov) Letting go outside the screen would tear the window off into
+			// an os window. The step is taken first, SDL_clamp evaluates its argument
+			// more than once.
+			i32 cursorX = input->cursorX + rngRange(rng, -20, 21);
+			i32 cursorY = input->cursorY + rngRange(rng, -20, 21);
+			cursorX = SDL_clamp(cursorX, 0, ui->width - 1);
+			cursorY = SDL_clamp(cursorY, 0, ui->height - 1);
+			scriptMouse(input, cursorX, cursorY, cycleFrame != cycleLength - 1);
+		}
+	} break;
+
+	case Scenario_ListScroll: {
+		UIWindowID listID = ui->windows.front;
+		SDL_Rect contentRect = uiGetWindowContentRect(ui, listID);
+		SDL_Rect track, thumb;
+		uiListGetScrollbarRects(ui, listID, &track, &thumb);
+		i32 cycleLength = 120;
+		i32 cycleFrame = frameIndex % cycleLength;
+		i32 wheelFrames = cycleLength / 2;
+		if (cycleFrame < wheelFrames) {
+			scriptMouse(input, contentRect.x + contentRect.w / 2, contentRect.y + contentRect.h / 2, false);
+			input->scrollY = (frameIndex / cycleLength) % 2 ? 2.0f : -2.0f;
+		} else {
+			i32 dragFrame = cycleFrame - wheelFrames;
+			SDL_Point top = {.x = track.x + track.w / 2, .y = track.y};
+			SDL_Point bottom = {.x = top.x, .y = track.y + track.h};
+			SDL_Point cursor = scriptLerp(top, bottom, dragFrame, cycleLength - wheelFrames - 1);
+			scriptMouse(input, cursor.x, cursor.y, cycleFrame != cycleLength - 1);
+		}
+	} break;
+
+	case Scenario_Count: break;
+	}
+}
+
+typedef struct ScenarioResult {
+	i32 frameCount;
+	f64 fps;
+	f64 p50Ms;
+	f64 p99Ms;
+	i32 setupAllocs;
+	i32 frameAllocs;
+	i32 steadyAllocs;
+	i32 pixelsTouched; // NOTE(khvorov) Per frame, on average
+	i32 latencyP50Ms; // NOTE(khvorov) Input to present, upper bound of the millisecond bucket
+	i32 latencyP99Ms;
+	i32 framesSkipped;
+	i32 frameArenaKB; // NOTE(khvorov) High water of the biggest frame arena
+	i32 persistentArenaKB;
+} ScenarioResult;
+
+// NOTE(khvorov) Presents whatever the render thread has left until it's been
+// quiet for a while. There is no way to ask it whether it's still drawing.
+void
+benchDrainPresents(App* app) {
+	SDL_Event event;
+	while (SDL_WaitEventTimeout(&event, 100)) {
+		if (event.type == app->presentEventType) {
+			appPresent(app);
+		}
+	}
+	appPresent(app);
+}
+
+// NOTE(khvorov) Goes through the same loop as the app: events are pumped, the
+// ui thread builds frames, the render thread draws them and the ui thread
+// presents. Frame times are the ui thread's share only, a loop iteration with
+// the present of an earlier frame in it. What it takes for input to show up on
+// the screen is the latency, which counts the render thread and the present.
+// Frames start back to back the way they do in immediate mode, so the render
+// thread can't keep up with the ui and most frames are built again before
+// they get drawn.
+ScenarioResult
+benchScenario(SDL_Window* sdlWindow, Scenario scenario, i32 frameCount) {
+	i32 setupAllocsBefore = SDL_AtomicGet(&globalAllocCounter.count);
+
+	App app;
+	appInit(&app, sdlWindow);
+	appStartRenderThread(&app);
+
+	if (scenario == Scenario_ManyWindows) {
+		Rng layoutRng = {.state = 0x9e3779b9};
+		for (i32 winIndex = 0; winIndex < 256; winIndex++) {
+			SDL_Rect rect = {
+				.x = rngRange(&layoutRng, -50, 900), .y = rngRange(&layoutRng, -50, 900),
+				.w = rngRange(&layoutRng, 50, 400), .h = rngRange(&layoutRng, 50, 300),
+			};
+			SDL_Color color = {.r = (u8)rngNext(&layoutRng), .g = (u8)rngNext(&layoutRng), .b = 0, .a = 255};
+			uiCreateWindow(&app.ui, rect, color);
+		}
+	}
+
+	if (scenario == Scenario_ListScroll) {
+		SDL_Rect rect = {.x = 100, .y = 50, .w = 600, .h = 800};
+		SDL_Color color = {.r = 0, .g = 150, .b = 150, .a = 255};
+		UIWindowHandle listWindow = uiCreateWindow(&app.ui, rect, color);
+		uiSetWindowList(&app.ui, listWindow.id, 10 * 1000 * 1000, uiListDemoGetRow, "row");
+	}
+
+	Input input = {0};
+	Rng rng = {.state = 0x12345678};
+	SDL_Point dragFrom = {0};
+	f64* frameMs = reallocArray(0, frameCount, sizeof(f64));
+
+	// NOTE(khvorov) The first frame sizes the ui and draws everything, which
+	// is setup as far as allocations are concerned
+	appFrame(&app, &input);
+	benchDrainPresents(&app);
+	i32 frameAllocsBefore = SDL_AtomicGet(&globalAllocCounter.count);
+	i32 latencyCountsBefore[PROFILE_LATENCY_BUCKETS];
+	profileCopyInputToPresentCounts(latencyCountsBefore);
+	i32 framesSkippedBefore = app.queue.framesSkipped;
+
+	// NOTE(khvorov) Anything allocated in the second half of the run is
+	// something the frame loop does every so often, not warm up
+	i32 steadyAllocsBefore = 0;
+
+	// NOTE(khvorov) The script is the input, whatever the os sends is pumped and
+	// dropped the way replay does it. The present wake ups go with it, appFrame
+	// presents first thing anyway.
+	i64 pixelsTouched = 0;
+	b32 running = true;
+	u64 runStart = SDL_GetPerformanceCounter();
+	for (i32 frameIndex = 0; frameIndex < frameCount; frameIndex++) {
+		if (frameIndex == frameCount / 2) {
+			steadyAllocsBefore = SDL_AtomicGet(&globalAllocCounter.count);
+		}
+		clearHalfTransitionCounts(&input);
+		scriptFrame(&app, &input, scenario, frameIndex, &rng, &dragFrom);
+		u64 frameStart = SDL_GetPerformanceCounter();
+		Input ignoredInput = {0};
+		pollEvents(sdlWindow, &running, &app.redrawAll, &ignoredInput);
+		input.eventTime = frameStart;
+		appFrame(&app, &input);
+		frameMs[frameIndex] = getSecondsSince(frameStart) * 1000.0;
+		pixelsTouched += app.frameStats.pixelsTouched;
+	}
+	benchDrainPresents(&app);
+	f64 runSeconds = getSecondsSince(runStart);
+
+	ScenarioResult result = {0};
+	result.frameCount = frameCount;
+	result.fps = (f64)frameCount / runSeconds;
+	result.setupAllocs = frameAllocsBefore - setupAllocsBefore;
+	result.frameAllocs = SDL_AtomicGet(&globalAllocCounter.count) - frameAllocsBefore;
+	result.steadyAllocs = SDL_AtomicGet(&globalAllocCounter.count) - steadyAllocsBefore;
+	result.pixelsTouched = (i32)(pixelsTouched / frameCount);
+	result.framesSkipped = app.queue.framesSkipped - framesSkippedBefore;
+
+	i32 latencyCounts[PROFILE_LATENCY_BUCKETS];
+	profileCopyInputToPresentCounts(latencyCounts);
+	i32 latencyTotal = 0;
+	for (i32 bucket = 0; bucket < PROFILE_LATENCY_BUCKETS; bucket++) {
+		latencyCounts[bucket] -= latencyCountsBefore[bucket];
+		latencyTotal += latencyCounts[bucket];
+	}
+	result.latencyP50Ms = profileGetInputToPresentPercentile(latencyCounts, latencyTotal, 50);
+	result.latencyP99Ms = profileGetInputToPresentPercentile(latencyCounts, latencyTotal, 99);
+
+	SDL_qsort(frameMs, frameCount, sizeof(f64), compareF64);
+	result.p50Ms = frameMs[frameCount / 2];
+	result.p99Ms = frameMs[SDL_min(frameCount * 99 / 100, frameCount - 1)];
+
+	for (i32 frameIndex = 0; frameIndex < 3; frameIndex++) {
+		Arena* frameArena = &app.queue.frames[frameIndex].arena;
+		result.frameArenaKB = SDL_max(result.frameArenaKB, (i32)(frameArena->highWater / 1024));
+	}
+	result.persistentArenaKB = (i32)(app.persistentArena.highWater / 1024);
+
+	SDL_free(frameMs);
+	appDeinit(&app);
+	return result;
+}
+
+// NOTE(khvorov) Runs headless on the dummy video driver unless
+// SDL_VIDEODRIVER says otherwise. Frame results go to the log and, as csv,
+// to the file given as the first argument or wiredeck_bench.csv. frame_ms is
+// the ui thread only, latency_ms is input to present through the render thread.
+int
+SDL_main(int argc, char* argv[]) {
+	allocCounterInstall();
+	SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+
+	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) == 0) {
+		for (HitTestLayout layout = 0; layout < HitTestLayout_Count; layout++) {
+			benchHitTest(layout);
+		}
+		benchScan();
+		benchTiles();
+		benchDockLayout();
+
+		SDL_Window* sdlWindow = SDL_CreateWindow("wiredeck_bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 1000, 1000, 0);
+		if (sdlWindow) {
+			char* csvPath = argc > 1 ? argv[1] : "wiredeck_bench.csv";
+			SDL_RWops* csv = SDL_RWFromFile(csvPath, "wb");
+
+			char* header = "scenario,frames,fps,frame_p50_ms,frame_p99_ms,latency_p50_ms,latency_p99_ms,frames_skipped,"
+				"setup_allocs,frame_allocs,steady_allocs,pixels_touched,frame_arena_kb,persistent_arena_kb";
+			SDL_Log("%s", header);
+			if (csv) {
+				SDL_RWwrite(csv, header, SDL_strlen(header), 1);
+				SDL_RWwrite(csv, "\n", 1, 1);
+			}
+
+			for (Scenario scenario = 0; scenario < Scenario_Count; scenario++) {
+				ScenarioResult result = benchScenario(sdlWindow, scenario, 2000);
+				char line[256];
+				i32 lineLen = SDL_snprintf(
+					line, sizeof(line), "%s,%d,%.1f,%.3f,%.3f,%d,%d,%d,%d,%d,%d,%d,%d,%d",
+					scenarioGetName(scenario), result.frameCount, result.fps, result.p50Ms, result.p99Ms,
+					result.latencyP50Ms, result.latencyP99Ms, result.framesSkipped,
+					result.setupAllocs, result.frameAllocs, result.steadyAllocs, result.pixelsTouched, result.frameArenaKB, result.persistentArenaKB
+				);
+				SDL_Log("%s", line);
+				if (csv) {
+					SDL_RWwrite(csv, line, lineLen, 1);
+					SDL_RWwrite(csv, "\n", 1, 1);
+				}
+			}
+
+			if (csv) {
+				SDL_RWclose(csv);
+			} else {
+				SDL_Log("could not open %s: %s", csvPath, SDL_GetError());
+			}
+		} else {
+			SDL_Log("could not create a window: %s", SDL_GetError());
+		}
+	}
+	return 0;
+}